@@ -0,0 +1,223 @@
+#ifndef CPPJIEBA_DICT_IMAGE_HPP
+#define CPPJIEBA_DICT_IMAGE_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace cppjieba {
+
+using namespace std;
+
+// Binary dictionary image: a flat sequence of PODs, strings and arrays.
+// Arrays start at 8-byte aligned offsets so that a mapped image can be used
+// in place, without copying.
+const char DICT_IMAGE_MAGIC[8] = {'C', 'J', 'D', 'I', 'C', 'T', 'I', 'M'};
+const uint32_t DICT_IMAGE_VERSION = 2; // 2: records the key normalizer
+const uint32_t DICT_IMAGE_BYTE_ORDER = 0x01020304;
+
+// size and modification time of a source file, both 0 if it does not exist
+inline void StatSourceFile(const string& path, uint64_t& size, int64_t& mtime) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    size = 0;
+    mtime = 0;
+    return;
+  }
+  size = static_cast<uint64_t>(st.st_size);
+  mtime = static_cast<int64_t>(st.st_mtime);
+}
+
+class DictImageWriter {
+ public:
+  template <class T>
+  void Put(const T& value) {
+    buf_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void PutString(const string& s) {
+    Put(static_cast<uint32_t>(s.size()));
+    buf_.append(s);
+  }
+
+  template <class T>
+  void PutArray(const T* data, size_t n) {
+    Put(static_cast<uint64_t>(n));
+    buf_.append((8 - buf_.size() % 8) % 8, '\0');
+    buf_.append(reinterpret_cast<const char*>(data), n * sizeof(T));
+  }
+
+  template <class T>
+  void PutArray(const vector<T>& v) {
+    PutArray(v.empty() ? NULL : &v[0], v.size());
+  }
+
+  // Written to a temporary file first and renamed, so that a reader never
+  // maps a half written image.
+  bool WriteTo(const string& path) const {
+    string tmp = path + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (fp == NULL) {
+      return false;
+    }
+    bool ok = fwrite(buf_.data(), 1, buf_.size(), fp) == buf_.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (ok) {
+      remove(path.c_str()); // rename does not replace an existing file on Windows
+      ok = rename(tmp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) {
+      remove(tmp.c_str());
+    }
+    return ok;
+  }
+
+  size_t Size() const {
+    return buf_.size();
+  }
+
+ private:
+  string buf_;
+}; // class DictImageWriter
+
+// Reads what DictImageWriter wrote. Every Get fails (returns false) instead
+// of reading past the end, so a truncated image is detected, not trusted.
+class DictImageReader {
+ public:
+  DictImageReader(const char* data, size_t size)
+    : data_(data), size_(size), pos_(0) {
+  }
+
+  template <class T>
+  bool Get(T& value) {
+    if (size_ - pos_ < sizeof(T)) {
+      return false;
+    }
+    memcpy(&value, data_ + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return true;
+  }
+
+  bool GetString(string& s) {
+    uint32_t n = 0;
+    if (!Get(n) || size_ - pos_ < n) {
+      return false;
+    }
+    s.assign(data_ + pos_, n);
+    pos_ += n;
+    return true;
+  }
+
+  // points into the image, no copy
+  template <class T>
+  bool GetArray(const T*& data, size_t& n) {
+    uint64_t count = 0;
+    if (!Get(count)) {
+      return false;
+    }
+    pos_ += (8 - pos_ % 8) % 8;
+    if (pos_ > size_ || (size_ - pos_) / sizeof(T) < count) {
+      return false;
+    }
+    data = reinterpret_cast<const T*>(data_ + pos_);
+    n = static_cast<size_t>(count);
+    pos_ += n * sizeof(T);
+    return true;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t pos_;
+}; // class DictImageReader
+
+// Read-only view of a whole file: mmap on POSIX, so that processes loading
+// the same image share its pages; a plain read into memory elsewhere.
+class MappedFile {
+ public:
+  MappedFile() : data_(NULL), size_(0) {
+  }
+  ~MappedFile() {
+    Close();
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const string& path) {
+    Close();
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      close(fd);
+      return false;
+    }
+    void* p = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      return false;
+    }
+    data_ = static_cast<const char*>(p);
+    size_ = static_cast<size_t>(st.st_size);
+    return true;
+#else
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == NULL) {
+      return false;
+    }
+    char chunk[1 << 16];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+      // uint64_t storage keeps the copy 8-byte aligned like a mapping
+      size_t old = size_;
+      size_ += n;
+      copy_.resize((size_ + 7) / 8);
+      memcpy(reinterpret_cast<char*>(&copy_[0]) + old, chunk, n);
+    }
+    fclose(fp);
+    data_ = size_ ? reinterpret_cast<const char*>(&copy_[0]) : NULL;
+    return size_ > 0;
+#endif
+  }
+
+  void Close() {
+#ifndef _WIN32
+    if (data_ != NULL) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+#else
+    vector<uint64_t>().swap(copy_);
+#endif
+    data_ = NULL;
+    size_ = 0;
+  }
+
+  const char* Data() const {
+    return data_;
+  }
+  size_t Size() const {
+    return size_;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+#ifdef _WIN32
+  vector<uint64_t> copy_;
+#endif
+}; // class MappedFile
+
+} // namespace cppjieba
+
+#endif // CPPJIEBA_DICT_IMAGE_HPP
@@ -14,6 +14,8 @@
 #include "limonp/Logging.hpp"
 #include "Unicode.hpp"
 #include "Trie.hpp"
+#include "DoubleArrayTrie.hpp"
+#include "DictImage.hpp"
 
 namespace cppjieba {
 
@@ -22,6 +24,57 @@ const double MAX_DOUBLE = 3.14e+100;
 const size_t DICT_COLUMN_NUM = 3;
 const char* const UNKNOWN_TAG = "";
 
+// tags assigned by PosTagger's rules to words without a dictionary tag
+static const char* const POS_M = "m";
+static const char* const POS_ENG = "eng";
+static const char* const POS_X = "x";
+
+// ids of the tags above, fixed because every TagTable registers them first
+const TagId TAG_ID_UNKNOWN = 0;
+const TagId TAG_ID_X = 1;
+const TagId TAG_ID_M = 2;
+const TagId TAG_ID_ENG = 3;
+
+// Maps part-of-speech tags to small integer ids and back.
+class TagTable {
+ public:
+  TagTable() {
+    Insert(UNKNOWN_TAG);
+    Insert(POS_X);
+    Insert(POS_M);
+    Insert(POS_ENG);
+  }
+
+  TagId Insert(const std::string& tag) {
+    std::unordered_map<std::string, TagId>::const_iterator it = ids_.find(tag);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    TagId id = static_cast<TagId>(names_.size());
+    names_.push_back(tag);
+    ids_[tag] = id;
+    return id;
+  }
+
+  // TAG_ID_UNKNOWN if the tag was never inserted
+  TagId Find(const std::string& tag) const {
+    std::unordered_map<std::string, TagId>::const_iterator it = ids_.find(tag);
+    return it == ids_.end() ? TAG_ID_UNKNOWN : it->second;
+  }
+
+  const std::string& Name(TagId id) const {
+    return names_[id];
+  }
+
+  size_t Size() const {
+    return names_.size();
+  }
+
+ private:
+  std::deque<std::string> names_; // deque: references stay valid on insert
+  std::unordered_map<std::string, TagId> ids_;
+}; // class TagTable
+
 class DictTrie {
  public:
   enum UserWordWeightOption {
@@ -30,7 +83,20 @@ class DictTrie {
     WordWeightMax,
   }; // enum UserWordWeightOption
 
-  DictTrie(const std::string& dict_path, const std::string& user_dict_paths = "", UserWordWeightOption user_word_weight_opt = WordWeightMedian) {
+  // Optional folding of dictionary keys, applied to every word before it is
+  // stored (main and user dictionaries, InsertUserWord), so that keys match
+  // text the caller folds the same way before segmenting. The image records
+  // `name`; an image built with other rules is not used.
+  struct KeyNormalizer {
+    const char* name;
+    bool (*fold)(std::string& word); // in place, true if the word changed
+  };
+
+  DictTrie(const std::string& dict_path, const std::string& user_dict_paths = "", UserWordWeightOption user_word_weight_opt = WordWeightMedian,
+           const KeyNormalizer* key_normalizer = NULL) {
+    if (key_normalizer != NULL) {
+      key_normalizer_ = *key_normalizer;
+    }
     Init(dict_path, user_dict_paths, user_word_weight_opt);
   }
 
@@ -38,6 +104,8 @@ class DictTrie {
     delete trie_;
   }
 
+  // Words added after construction go to the (pointer based) overlay trie,
+  // the static dictionary lives in the double-array trie and never changes.
   bool InsertUserWord(const std::string& word, const std::string& tag = UNKNOWN_TAG) {
     DictUnit node_info;
     if (!MakeNodeInfo(node_info, word, user_word_default_weight_, tag)) {
@@ -59,24 +127,69 @@ class DictTrie {
     return true;
   }
 
+  // The word is masked in the overlay, so this also removes dictionary words.
   bool DeleteUserWord(const std::string& word, const std::string& tag = UNKNOWN_TAG) {
     DictUnit node_info;
     if (!MakeNodeInfo(node_info, word, user_word_default_weight_, tag)) {
       return false;
     }
-    trie_->DeleteNode(node_info.word, &node_info);
+    trie_->InsertNode(node_info.word, &deleted_unit_);
     return true;
   }
 
   const DictUnit* Find(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
-    return trie_->Find(begin, end);
+    if (begin == end) {
+      return NULL;
+    }
+    const TrieNode* node = trie_->Root();
+    int32_t state = dat_.Root();
+    for (RuneStrArray::const_iterator it = begin; it != end; ++it) {
+      node = Trie::Child(node, it->rune);
+      if (state != DoubleArrayTrie::kNoState) {
+        state = dat_.Child(state, it->rune);
+      }
+      if (node == NULL && state == DoubleArrayTrie::kNoState) {
+        return NULL;
+      }
+    }
+    return Value(node, state);
   }
 
+  // Same result as Trie::Find over all words: the overlay and the static
+  // trie are walked side by side and the overlay wins where both have a word.
   void Find(RuneStrArray::const_iterator begin,
         RuneStrArray::const_iterator end,
         std::vector<struct Dag>&res,
         size_t max_word_len = MAX_WORD_LENGTH) const {
-    trie_->Find(begin, end, res, max_word_len);
+    size_t n = end - begin;
+    res.resize(n);
+    const TrieNode* root = trie_->Root();
+    bool has_overlay = root->next != NULL;
+    for (size_t i = 0; i < n; i++) {
+      res[i].runestr = *(begin + i);
+      res[i].nexts.reset(); // res may be a reused buffer
+
+      const TrieNode* node = has_overlay ? Trie::Child(root, res[i].runestr.rune) : NULL;
+      int32_t state = dat_.Child(0, res[i].runestr.rune);
+      res[i].nexts.push_back(pair<size_t, const DictUnit*>(i, Value(node, state)));
+
+      for (size_t j = i + 1; j < n && (j - i + 1) <= max_word_len; j++) {
+        Rune rune = (begin + j)->rune;
+        if (node != NULL) {
+          node = Trie::Child(node, rune);
+        }
+        if (state != DoubleArrayTrie::kNoState) {
+          state = dat_.Child(state, rune);
+        }
+        if (node == NULL && state == DoubleArrayTrie::kNoState) {
+          break;
+        }
+        const DictUnit* unit = Value(node, state);
+        if (unit != NULL) {
+          res[i].nexts.push_back(pair<size_t, const DictUnit*>(j, unit));
+        }
+      }
+    }
   }
 
   bool Find(const std::string& word)
@@ -98,6 +211,86 @@ class DictTrie {
     }
   }
 
+  const std::string& GetTagName(TagId id) const {
+    return tags_.Name(id);
+  }
+
+  TagId GetTagId(const std::string& tag) const {
+    return tags_.Find(tag);
+  }
+
+  size_t GetTagCount() const {
+    return tags_.Size();
+  }
+
+  // Where Init looks for the precompiled image of dict_path.
+  static std::string ImagePath(const std::string& dict_path) {
+    return dict_path + ".bin";
+  }
+
+  // Write the loaded static dictionary (trie arrays, words, weights, tags)
+  // as a binary image. It records size and mtime of every source file and
+  // is only used while those match. Words inserted at runtime are not saved.
+  bool SaveImage(const std::string& image_path) const {
+    DictImageWriter w;
+    w.Put(DICT_IMAGE_MAGIC);
+    w.Put(DICT_IMAGE_VERSION);
+    w.Put(DICT_IMAGE_BYTE_ORDER);
+    w.Put(static_cast<uint32_t>(user_word_weight_opt_));
+    w.PutString(KeyNormalizerName());
+    std::vector<std::string> sources = SourceFiles(dict_path_, user_dict_paths_);
+    w.Put(static_cast<uint32_t>(sources.size()));
+    for (size_t i = 0; i < sources.size(); i++) {
+      uint64_t size;
+      int64_t mtime;
+      StatSourceFile(sources[i], size, mtime);
+      w.PutString(sources[i]);
+      w.Put(size);
+      w.Put(mtime);
+    }
+    w.Put(freq_sum_);
+    w.Put(min_weight_);
+    w.Put(max_weight_);
+    w.Put(median_weight_);
+    w.Put(user_word_default_weight_);
+
+    w.Put(static_cast<uint32_t>(tags_.Size()));
+    for (size_t i = 0; i < tags_.Size(); i++) {
+      w.PutString(tags_.Name(static_cast<TagId>(i)));
+    }
+
+    std::vector<double> weights;
+    std::vector<TagId> tag_ids;
+    std::vector<uint32_t> word_offsets(1, 0);
+    std::vector<uint32_t> runes;
+    for (size_t i = 0; i < static_node_infos_.size(); i++) {
+      const DictUnit& unit = static_node_infos_[i];
+      weights.push_back(unit.weight);
+      tag_ids.push_back(unit.tag_id);
+      runes.insert(runes.end(), unit.word.begin(), unit.word.end());
+      word_offsets.push_back(static_cast<uint32_t>(runes.size()));
+    }
+    w.PutArray(weights);
+    w.PutArray(tag_ids);
+    w.PutArray(word_offsets);
+    w.PutArray(runes);
+    std::vector<uint32_t> singles(user_dict_single_chinese_word_.begin(), user_dict_single_chinese_word_.end());
+    std::sort(singles.begin(), singles.end());
+    w.PutArray(singles);
+
+    w.PutArray(dat_.BaseArray(), dat_.Size());
+    w.PutArray(dat_.CheckArray(), dat_.Size());
+    w.PutArray(dat_.ValueArray(), dat_.Size());
+    w.PutArray(dat_.CodeArray(), dat_.CodeCount());
+    w.PutArray(dat_.OtherCodePairs());
+    return w.WriteTo(image_path);
+  }
+
+  // true if the static dictionary came from a binary image
+  bool LoadedFromImage() const {
+    return image_.Data() != NULL;
+  }
+
   bool IsUserDictSingleChineseWord(const Rune& word) const {
     return IsIn(user_dict_single_chinese_word_, word);
   }
@@ -106,6 +299,21 @@ class DictTrie {
     return min_weight_;
   }
 
+  // Estimated bytes of the dictionary: the double array (or the mapped
+  // image it points into), the word entries and the runtime overlay trie.
+  size_t MemoryBytes() const {
+    size_t bytes = dat_.MemoryBytes() + image_.Size() + trie_->MemoryBytes();
+    bytes += static_node_infos_.capacity() * sizeof(DictUnit) + active_node_infos_.size() * sizeof(DictUnit);
+    for (size_t i = 0; i < static_node_infos_.size(); i++) {
+      bytes += UnitHeapBytes(static_node_infos_[i]);
+    }
+    for (size_t i = 0; i < active_node_infos_.size(); i++) {
+      bytes += UnitHeapBytes(active_node_infos_[i]);
+    }
+    bytes += user_dict_single_chinese_word_.size() * (sizeof(Rune) + sizeof(void*));
+    return bytes;
+  }
+
   void InserUserDictNode(const std::string& line) {
     std::vector<std::string> buf;
     DictUnit node_info;
@@ -163,7 +371,25 @@ class DictTrie {
 
 
  private:
+  // word runes past the LocalVector's inline buffer, tag text past the SSO buffer
+  static size_t UnitHeapBytes(const DictUnit& unit) {
+    size_t bytes = unit.word.capacity() > limonp::LOCAL_VECTOR_BUFFER_SIZE ? unit.word.capacity() * sizeof(Rune) : 0;
+    return bytes + (unit.tag.capacity() > 15 ? unit.tag.capacity() + 1 : 0);
+  }
+
+  std::string KeyNormalizerName() const {
+    return key_normalizer_.fold != NULL && key_normalizer_.name != NULL ? key_normalizer_.name : "";
+  }
+
   void Init(const std::string& dict_path, const std::string& user_dict_paths, UserWordWeightOption user_word_weight_opt) {
+    dict_path_ = dict_path;
+    user_dict_paths_ = user_dict_paths;
+    user_word_weight_opt_ = user_word_weight_opt;
+    trie_ = new Trie(std::vector<Unicode>(), std::vector<const DictUnit*>());
+    if (LoadImage(ImagePath(dict_path))) {
+      return;
+    }
+
     LoadDict(dict_path);
     freq_sum_ = CalcFreqSum(static_node_infos_);
     CalculateWeight(static_node_infos_, freq_sum_);
@@ -179,25 +405,165 @@ class DictTrie {
   void CreateTrie(const std::vector<DictUnit>& dictUnits) {
     assert(dictUnits.size());
     std::vector<Unicode> words;
-    std::vector<const DictUnit*> valuePointers;
+    words.reserve(dictUnits.size());
     for (size_t i = 0 ; i < dictUnits.size(); i ++) {
       words.push_back(dictUnits[i].word);
-      valuePointers.push_back(&dictUnits[i]);
     }
+    dat_.Build(words);
+  }
+
+  static std::vector<std::string> SourceFiles(const std::string& dict_path, const std::string& user_dict_paths) {
+    std::vector<std::string> files(1, dict_path);
+    if (!user_dict_paths.empty()) {
+      std::vector<std::string> user_files = limonp::Split(user_dict_paths, "|;");
+      files.insert(files.end(), user_files.begin(), user_files.end());
+    }
+    return files;
+  }
 
-    trie_ = new Trie(words, valuePointers);
+  // Use the image at path if it exists and was built from the current
+  // sources with the same options; false means parse the text dictionary.
+  bool LoadImage(const std::string& path) {
+    if (!image_.Open(path)) {
+      return false;
+    }
+    if (!ReadImage()) {
+      XLOG(WARNING) << "dictionary image " << path << " is stale or invalid, loading the text dictionary";
+      static_node_infos_.clear();
+      user_dict_single_chinese_word_.clear();
+      tags_ = TagTable();
+      dat_.Clear();
+      image_.Close();
+      return false;
+    }
+    return true;
+  }
+
+  bool ReadImage() {
+    DictImageReader r(image_.Data(), image_.Size());
+    char magic[sizeof(DICT_IMAGE_MAGIC)];
+    uint32_t version, byte_order, opt, nsources;
+    std::string normalizer;
+    if (!r.Get(magic) || memcmp(magic, DICT_IMAGE_MAGIC, sizeof(magic)) != 0 ||
+        !r.Get(version) || version != DICT_IMAGE_VERSION ||
+        !r.Get(byte_order) || byte_order != DICT_IMAGE_BYTE_ORDER ||
+        !r.Get(opt) || opt != static_cast<uint32_t>(user_word_weight_opt_) ||
+        !r.GetString(normalizer) || normalizer != KeyNormalizerName() ||
+        !r.Get(nsources)) {
+      return false;
+    }
+    std::vector<std::string> sources = SourceFiles(dict_path_, user_dict_paths_);
+    if (nsources != sources.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < sources.size(); i++) {
+      std::string path;
+      uint64_t size, cur_size;
+      int64_t mtime, cur_mtime;
+      if (!r.GetString(path) || !r.Get(size) || !r.Get(mtime)) {
+        return false;
+      }
+      StatSourceFile(sources[i], cur_size, cur_mtime);
+      if (path != sources[i] || size != cur_size || mtime != cur_mtime) {
+        return false;
+      }
+    }
+    if (!r.Get(freq_sum_) || !r.Get(min_weight_) || !r.Get(max_weight_) ||
+        !r.Get(median_weight_) || !r.Get(user_word_default_weight_)) {
+      return false;
+    }
+
+    uint32_t ntags;
+    if (!r.Get(ntags)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < ntags; i++) {
+      std::string tag;
+      // ids must come out as they were written; the first ones are preset
+      if (!r.GetString(tag) || tags_.Insert(tag) != i) {
+        return false;
+      }
+    }
+
+    const double* weights;
+    const TagId* tag_ids;
+    const uint32_t* word_offsets;
+    const uint32_t* runes;
+    const uint32_t* singles;
+    size_t nunits, ntag_ids, noffsets, nrunes, nsingles;
+    if (!r.GetArray(weights, nunits) || !r.GetArray(tag_ids, ntag_ids) ||
+        !r.GetArray(word_offsets, noffsets) || !r.GetArray(runes, nrunes) ||
+        !r.GetArray(singles, nsingles) ||
+        ntag_ids != nunits || noffsets != nunits + 1 || word_offsets[nunits] != nrunes) {
+      return false;
+    }
+    static_node_infos_.resize(nunits);
+    for (size_t i = 0; i < nunits; i++) {
+      DictUnit& unit = static_node_infos_[i];
+      if (word_offsets[i] > word_offsets[i + 1] || tag_ids[i] >= ntags) {
+        return false;
+      }
+      unit.word.clear();
+      for (uint32_t j = word_offsets[i]; j < word_offsets[i + 1]; j++) {
+        unit.word.push_back(runes[j]);
+      }
+      unit.weight = weights[i];
+      unit.tag_id = tag_ids[i];
+      unit.tag = tags_.Name(tag_ids[i]);
+    }
+    user_dict_single_chinese_word_.insert(singles, singles + nsingles);
+
+    const int32_t* base;
+    const int32_t* check;
+    const int32_t* value;
+    const uint32_t* codes;
+    const uint32_t* other_pairs;
+    size_t nbase, ncheck, nvalue, ncodes, nother;
+    if (!r.GetArray(base, nbase) || !r.GetArray(check, ncheck) || !r.GetArray(value, nvalue) ||
+        !r.GetArray(codes, ncodes) || !r.GetArray(other_pairs, nother) ||
+        nbase == 0 || ncheck != nbase || nvalue != nbase || nother % 2 != 0) {
+      return false;
+    }
+    for (size_t i = 0; i < nvalue; i++) {
+      if (value[i] >= static_cast<int32_t>(nunits)) {
+        return false;
+      }
+    }
+    // the arrays stay in the mapping, shared with every process using the image
+    dat_.Attach(base, check, value, nbase, codes, ncodes, other_pairs, nother / 2);
+    return true;
+  }
+
+  // overlay entry first, then the static dictionary
+  const DictUnit* Value(const TrieNode* node, int32_t state) const {
+    if (node != NULL && node->ptValue != NULL) {
+      return node->ptValue == &deleted_unit_ ? NULL : node->ptValue;
+    }
+    if (state == DoubleArrayTrie::kNoState) {
+      return NULL;
+    }
+    int32_t index = dat_.Value(state);
+    return index == DoubleArrayTrie::kNoValue ? NULL : &static_node_infos_[index];
   }
 
   bool MakeNodeInfo(DictUnit& node_info,
         const std::string& word,
         double weight,
         const std::string& tag) {
-    if (!DecodeUTF8RunesInString(word, node_info.word)) {
+    const std::string* key = &word;
+    std::string folded;
+    if (key_normalizer_.fold != NULL) {
+      folded = word;
+      key_normalizer_.fold(folded);
+      key = &folded;
+    }
+    if (!DecodeUTF8RunesInString(*key, node_info.word)) {
       XLOG(ERROR) << "UTF-8 decode failed for dict word: " << word;
       return false;
     }
     node_info.weight = weight;
     node_info.tag = tag;
+    node_info.tag_id = tags_.Insert(tag);
     return true;
   }
 
@@ -264,9 +630,17 @@ class DictTrie {
     std::vector<DictUnit>(units.begin(), units.end()).swap(units);
   }
 
+  std::string dict_path_;
+  std::string user_dict_paths_;
+  UserWordWeightOption user_word_weight_opt_;
+  KeyNormalizer key_normalizer_ = KeyNormalizer(); // none by default
+  MappedFile image_;    // backs dat_ when loaded from an image
+
   std::vector<DictUnit> static_node_infos_;
   std::deque<DictUnit> active_node_infos_; // must not be std::vector
-  Trie * trie_;
+  DoubleArrayTrie dat_; // static_node_infos_, values are indices into it
+  Trie * trie_;         // overlay: words inserted or deleted at runtime
+  DictUnit deleted_unit_; // overlay value of a deleted word
 
   double freq_sum_;
   double min_weight_;
@@ -274,6 +648,7 @@ class DictTrie {
   double median_weight_;
   double user_word_default_weight_;
   std::unordered_set<Rune> user_dict_single_chinese_word_;
+  TagTable tags_;
 };
 }
 
@@ -0,0 +1,396 @@
+#ifndef CPPJIEBA_DOUBLE_ARRAY_TRIE_HPP
+#define CPPJIEBA_DOUBLE_ARRAY_TRIE_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Unicode.hpp"
+
+namespace cppjieba {
+
+using namespace std;
+
+// Static trie in two flat int arrays (base/check), built once from the whole
+// dictionary. Runes are first mapped to dense codes, most frequent rune first,
+// so the arrays stay compact; a transition is base[s] + code, valid when
+// check[] of the target points back to s. The value of a state is an index
+// into the caller's DictUnit array, -1 if no word ends there.
+//
+// Lookups read the arrays through plain pointers, so a trie can either own
+// them (Build) or use arrays that live elsewhere, e.g. in a read-only mapped
+// dictionary image (Attach).
+class DoubleArrayTrie {
+ public:
+  static constexpr int32_t kNoValue = -1;
+  static constexpr int32_t kNoState = -1;
+
+  DoubleArrayTrie()
+    : b_(NULL), c_(NULL), v_(NULL), n_(0), codes_(NULL), ncodes_(0) {
+  }
+  DoubleArrayTrie(const DoubleArrayTrie&) = delete;
+  DoubleArrayTrie& operator=(const DoubleArrayTrie&) = delete;
+
+  // keys[i] gets value i; if a key occurs more than once the last one wins.
+  void Build(const vector<Unicode>& keys) {
+    Clear();
+    BuildCodes(keys);
+
+    vector<vector<uint32_t> > coded(keys.size());
+    vector<uint32_t> order(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      coded[i].resize(keys[i].size());
+      for (size_t j = 0; j < keys[i].size(); j++) {
+        coded[i][j] = Code(keys[i][j]);
+      }
+      order[i] = static_cast<uint32_t>(i);
+    }
+    // stable: equal keys keep their input order, so the last one is the winner
+    stable_sort(order.begin(), order.end(), KeyLess(coded));
+
+    free_head_ = kNoState;
+    Resize(1024);
+    Take(0);
+    check_[0] = 0; // root, its own parent
+    BuildNode(0, coded, order, 0, order.size(), 0);
+    Shrink();
+    vector<int32_t>().swap(free_next_);
+    vector<int32_t>().swap(free_prev_);
+    vector<uint8_t>().swap(trials_);
+    b_ = base_.data();
+    c_ = check_.data();
+    v_ = value_.data();
+    n_ = check_.size();
+    codes_ = bmp_codes_.data();
+    ncodes_ = bmp_codes_.size();
+  }
+
+  // Use arrays owned by someone else (they must outlive this trie): n states
+  // of base/check/value, the rune -> code table below U+10000, and the
+  // (rune, code) pairs above it.
+  void Attach(const int32_t* base, const int32_t* check, const int32_t* value, size_t n,
+        const uint32_t* bmp_codes, size_t ncodes,
+        const uint32_t* other_pairs, size_t nother) {
+    Clear();
+    b_ = base;
+    c_ = check;
+    v_ = value;
+    n_ = n;
+    codes_ = bmp_codes;
+    ncodes_ = ncodes;
+    for (size_t i = 0; i < nother; i++) {
+      other_codes_[other_pairs[2 * i]] = other_pairs[2 * i + 1];
+    }
+  }
+
+  void Clear() {
+    base_.clear();
+    check_.clear();
+    value_.clear();
+    bmp_codes_.clear();
+    other_codes_.clear();
+    b_ = c_ = v_ = NULL;
+    n_ = 0;
+    codes_ = NULL;
+    ncodes_ = 0;
+  }
+
+  bool Empty() const {
+    return n_ == 0;
+  }
+
+  // 0 for a rune that occurs in no key
+  uint32_t Code(Rune rune) const {
+    if (rune < ncodes_) {
+      return codes_[rune];
+    }
+    if (other_codes_.empty()) {
+      return 0;
+    }
+    unordered_map<Rune, uint32_t>::const_iterator it = other_codes_.find(rune);
+    return it == other_codes_.end() ? 0 : it->second;
+  }
+
+  int32_t Root() const {
+    return n_ == 0 ? kNoState : 0;
+  }
+
+  // kNoState if there is no such transition
+  int32_t Child(int32_t state, Rune rune) const {
+    uint32_t code = Code(rune);
+    if (code == 0) {
+      return kNoState;
+    }
+    size_t t = static_cast<size_t>(b_[state]) + code;
+    if (t >= n_ || c_[t] != state) {
+      return kNoState;
+    }
+    return static_cast<int32_t>(t);
+  }
+
+  int32_t Value(int32_t state) const {
+    return v_[state];
+  }
+
+  int32_t Find(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
+    int32_t s = Root();
+    for (RuneStrArray::const_iterator it = begin; it != end && s != kNoState; ++it) {
+      s = Child(s, it->rune);
+    }
+    return (s == kNoState || begin == end) ? kNoValue : v_[s];
+  }
+
+  size_t Size() const {
+    return n_;
+  }
+
+  // raw arrays, for writing them out
+  const int32_t* BaseArray() const {
+    return b_;
+  }
+  const int32_t* CheckArray() const {
+    return c_;
+  }
+  const int32_t* ValueArray() const {
+    return v_;
+  }
+  const uint32_t* CodeArray() const {
+    return codes_;
+  }
+  size_t CodeCount() const {
+    return ncodes_;
+  }
+  // (rune, code) pairs of the runes above U+FFFF, sorted by rune
+  vector<uint32_t> OtherCodePairs() const {
+    vector<pair<Rune, uint32_t> > sorted(other_codes_.begin(), other_codes_.end());
+    sort(sorted.begin(), sorted.end());
+    vector<uint32_t> res;
+    for (size_t i = 0; i < sorted.size(); i++) {
+      res.push_back(sorted[i].first);
+      res.push_back(sorted[i].second);
+    }
+    return res;
+  }
+
+  // heap bytes owned by this trie (attached arrays are not counted)
+  size_t MemoryBytes() const {
+    return (base_.capacity() + check_.capacity() + value_.capacity()) * sizeof(int32_t)
+      + bmp_codes_.capacity() * sizeof(uint32_t)
+      + other_codes_.size() * (sizeof(Rune) + sizeof(uint32_t) + 2 * sizeof(void*));
+  }
+
+ private:
+  struct KeyLess {
+    explicit KeyLess(const vector<vector<uint32_t> >& keys) : keys_(keys) {
+    }
+    bool operator()(uint32_t a, uint32_t b) const {
+      return keys_[a] < keys_[b];
+    }
+    const vector<vector<uint32_t> >& keys_;
+  };
+
+  void BuildCodes(const vector<Unicode>& keys) {
+    unordered_map<Rune, size_t> freq;
+    for (size_t i = 0; i < keys.size(); i++) {
+      for (size_t j = 0; j < keys[i].size(); j++) {
+        freq[keys[i][j]]++;
+      }
+    }
+    vector<pair<size_t, Rune> > by_freq;
+    by_freq.reserve(freq.size());
+    Rune max_bmp = 0;
+    for (unordered_map<Rune, size_t>::const_iterator it = freq.begin(); it != freq.end(); ++it) {
+      by_freq.push_back(make_pair(it->second, it->first));
+      if (it->first < 0x10000 && it->first > max_bmp) {
+        max_bmp = it->first;
+      }
+    }
+    // descending frequency, rune as tie-break so the layout is deterministic
+    sort(by_freq.begin(), by_freq.end(), FreqGreater);
+    bmp_codes_.assign(by_freq.empty() ? 0 : max_bmp + 1, 0);
+    for (size_t i = 0; i < by_freq.size(); i++) {
+      Rune r = by_freq[i].second;
+      uint32_t code = static_cast<uint32_t>(i + 1);
+      if (r < 0x10000) {
+        bmp_codes_[r] = code;
+      } else {
+        other_codes_[r] = code;
+      }
+    }
+    codes_ = bmp_codes_.data();
+    ncodes_ = bmp_codes_.size();
+  }
+
+  static bool FreqGreater(const pair<size_t, Rune>& a, const pair<size_t, Rune>& b) {
+    if (a.first != b.first) {
+      return a.first > b.first;
+    }
+    return a.second < b.second;
+  }
+
+  // Place the children of `state`, which stands for the common prefix of
+  // length `depth` of the sorted keys order[begin, end).
+  void BuildNode(int32_t state, const vector<vector<uint32_t> >& coded, const vector<uint32_t>& order,
+        size_t begin, size_t end, size_t depth) {
+    // keys that end here come first in sorted order; the last of them wins
+    while (begin < end && coded[order[begin]].size() == depth) {
+      value_[state] = static_cast<int32_t>(order[begin]);
+      begin++;
+    }
+    if (begin == end) {
+      return;
+    }
+    // child codes in ascending order, each with its key range
+    vector<pair<uint32_t, pair<size_t, size_t> > > children;
+    for (size_t i = begin; i < end;) {
+      uint32_t c = coded[order[i]][depth];
+      size_t j = i + 1;
+      while (j < end && coded[order[j]][depth] == c) {
+        j++;
+      }
+      children.push_back(make_pair(c, make_pair(i, j)));
+      i = j;
+    }
+
+    int32_t base = FindBase(children);
+    base_[state] = base;
+    for (size_t i = 0; i < children.size(); i++) {
+      Take(base + children[i].first);
+      check_[base + children[i].first] = state;
+    }
+    for (size_t i = 0; i < children.size(); i++) {
+      BuildNode(base + static_cast<int32_t>(children[i].first), coded, order,
+            children[i].second.first, children[i].second.second, depth + 1);
+    }
+  }
+
+  // A base >= 1 at which every child code lands on a free slot. Only free
+  // slots are tried for the first child, found through the free list; a slot
+  // that failed kMaxTrials times leaves the list (it can still be taken by a
+  // later child), which keeps the search from rescanning a crowded region.
+  int32_t FindBase(const vector<pair<uint32_t, pair<size_t, size_t> > >& children) {
+    uint32_t first = children[0].first;
+    if (free_head_ == kNoState) {
+      Resize(check_.size() + 1);
+    }
+    int32_t pos = free_head_;
+    while (true) {
+      if (static_cast<uint32_t>(pos) > first) {
+        size_t base = pos - first;
+        size_t last = base + children.back().first;
+        if (last >= check_.size()) {
+          Resize(last + 1);
+        }
+        bool ok = true;
+        for (size_t i = 1; i < children.size(); i++) {
+          if (check_[base + children[i].first] != kNoState) {
+            ok = false;
+            break;
+          }
+        }
+        if (ok) {
+          return static_cast<int32_t>(base);
+        }
+      }
+      int32_t tried = pos;
+      pos = free_next_[pos];
+      if (trials_[tried] < kMaxTrials) {
+        trials_[tried]++;
+      }
+      if (trials_[tried] >= kMaxTrials && pos != tried) {
+        bool was_head = (tried == free_head_);
+        Take(tried);
+        if (was_head) {
+          continue; // pos is the new head: test it before the wrap check
+        }
+      }
+      if (pos == free_head_) {
+        // every free slot tried: grow, the new slots follow the old end
+        size_t old_size = check_.size();
+        Resize(old_size + 1);
+        pos = static_cast<int32_t>(old_size);
+      }
+    }
+  }
+
+  void Resize(size_t n) {
+    if (n <= check_.size()) {
+      return;
+    }
+    size_t old_size = check_.size();
+    size_t cap = max<size_t>(n, old_size * 2);
+    base_.resize(cap, 0);
+    check_.resize(cap, kNoState);
+    value_.resize(cap, kNoValue);
+    free_next_.resize(cap);
+    free_prev_.resize(cap);
+    trials_.resize(cap, 0);
+    // append the new slots to the circular free list
+    for (size_t i = old_size; i < cap; i++) {
+      int32_t s = static_cast<int32_t>(i);
+      if (free_head_ == kNoState) {
+        free_head_ = free_next_[s] = free_prev_[s] = s;
+        continue;
+      }
+      int32_t tail = free_prev_[free_head_];
+      free_next_[tail] = s;
+      free_prev_[s] = tail;
+      free_next_[s] = free_head_;
+      free_prev_[free_head_] = s;
+    }
+  }
+
+  // Remove a slot from the free list (if it is still on it).
+  void Take(int32_t s) {
+    if (trials_[s] == kTaken) {
+      return;
+    }
+    trials_[s] = kTaken;
+    if (free_next_[s] == s) {
+      free_head_ = kNoState;
+      return;
+    }
+    free_next_[free_prev_[s]] = free_next_[s];
+    free_prev_[free_next_[s]] = free_prev_[s];
+    if (free_head_ == s) {
+      free_head_ = free_next_[s];
+    }
+  }
+
+  void Shrink() {
+    size_t n = check_.size();
+    while (n > 1 && check_[n - 1] == kNoState) {
+      n--;
+    }
+    vector<int32_t>(base_.begin(), base_.begin() + n).swap(base_);
+    vector<int32_t>(check_.begin(), check_.begin() + n).swap(check_);
+    vector<int32_t>(value_.begin(), value_.begin() + n).swap(value_);
+  }
+
+  vector<int32_t> base_;
+  vector<int32_t> check_;   // parent state, kNoState for a free slot
+  vector<int32_t> value_;
+  vector<uint32_t> bmp_codes_;                 // rune -> code below U+10000
+  unordered_map<Rune, uint32_t> other_codes_;  // rune -> code above
+  // read view: the vectors above after Build, or attached arrays
+  const int32_t* b_;
+  const int32_t* c_;
+  const int32_t* v_;
+  size_t n_;
+  const uint32_t* codes_;
+  size_t ncodes_;
+
+  // build only: circular doubly linked list of free slots
+  static constexpr uint8_t kMaxTrials = 16;
+  static constexpr uint8_t kTaken = 255;
+  vector<int32_t> free_next_;
+  vector<int32_t> free_prev_;
+  vector<uint8_t> trials_;  // failed tries of a free slot, kTaken once off the list
+  int32_t free_head_;
+}; // class DoubleArrayTrie
+
+} // namespace cppjieba
+
+#endif // CPPJIEBA_DOUBLE_ARRAY_TRIE_HPP
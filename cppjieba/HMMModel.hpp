@@ -3,12 +3,18 @@
 
 #include "limonp/StringUtil.hpp"
 #include "Trie.hpp"
+#include "DictTrie.hpp"
 
 namespace cppjieba {
 
 using namespace limonp;
 typedef unordered_map<Rune, double> EmitProbMap;
 
+// Emission log probabilities of one rune, indexed by status.
+struct EmitRow {
+  double prob[4];
+}; // struct EmitRow
+
 struct HMMModel {
   /*
    * STATUS:
@@ -16,6 +22,10 @@ struct HMMModel {
    * */
   enum {B = 0, E = 1, M = 2, S = 3, STATUS_SUM = 4};
 
+  // CJK Unified Ideographs, where nearly all HMM input lies: their emission
+  // rows are a dense array indexed by rune, the rest is hashed.
+  enum {CJK_BEGIN = 0x4E00, CJK_END = 0xA000};
+
   HMMModel(const string& modelPath) {
     memset(startProb, 0, sizeof(startProb));
     memset(transProb, 0, sizeof(transProb));
@@ -70,6 +80,47 @@ struct HMMModel {
     //Load emitProbS
     XCHECK(GetLine(ifile, line));
     XCHECK(LoadEmitProb(line, emitProbS));
+
+    BuildEmitRows();
+  }
+
+  // Emission row of rune; statuses without a probability get MIN_DOUBLE,
+  // as GetEmitProb(..., MIN_DOUBLE) returns.
+  const EmitRow& GetEmitRow(Rune rune) const {
+    if (rune >= CJK_BEGIN && rune < CJK_END) {
+      return cjkEmitRows[rune - CJK_BEGIN];
+    }
+    unordered_map<Rune, EmitRow>::const_iterator cit = otherEmitRows.find(rune);
+    return cit == otherEmitRows.end() ? missingEmitRow : cit->second;
+  }
+  // estimated bytes of the emission tables: the four parsed maps and the rows
+  size_t MemoryBytes() const {
+    size_t bytes = cjkEmitRows.capacity() * sizeof(EmitRow)
+      + otherEmitRows.bucket_count() * sizeof(void*)
+      + otherEmitRows.size() * (sizeof(Rune) + sizeof(EmitRow) + sizeof(void*));
+    for (size_t i = 0; i < emitProbVec.size(); i++) {
+      bytes += emitProbVec[i]->bucket_count() * sizeof(void*)
+        + emitProbVec[i]->size() * (sizeof(Rune) + sizeof(double) + sizeof(void*));
+    }
+    return bytes;
+  }
+  void BuildEmitRows() {
+    for (size_t y = 0; y < STATUS_SUM; y++) {
+      missingEmitRow.prob[y] = MIN_DOUBLE;
+    }
+    cjkEmitRows.assign(CJK_END - CJK_BEGIN, missingEmitRow);
+    otherEmitRows.clear();
+    for (size_t y = 0; y < STATUS_SUM; y++) {
+      const EmitProbMap& mp = *emitProbVec[y];
+      for (EmitProbMap::const_iterator it = mp.begin(); it != mp.end(); ++it) {
+        Rune rune = it->first;
+        if (rune >= CJK_BEGIN && rune < CJK_END) {
+          cjkEmitRows[rune - CJK_BEGIN].prob[y] = it->second;
+        } else {
+          otherEmitRows.insert(make_pair(rune, missingEmitRow)).first->second.prob[y] = it->second;
+        }
+      }
+    }
   }
   double GetEmitProb(const EmitProbMap* ptMp, Rune key, 
         double defVal)const {
@@ -122,6 +173,9 @@ struct HMMModel {
   EmitProbMap emitProbM;
   EmitProbMap emitProbS;
   vector<EmitProbMap* > emitProbVec;
+  vector<EmitRow> cjkEmitRows; // rune - CJK_BEGIN
+  unordered_map<Rune, EmitRow> otherEmitRows;
+  EmitRow missingEmitRow;
 }; // struct HMMModel
 
 } // namespace cppjieba
@@ -5,8 +5,12 @@
 #include <fstream>
 #include <memory.h>
 #include <cassert>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "HMMModel.hpp"
 #include "SegmentBase.hpp"
+#include "SegmentScratch.hpp"
 
 namespace cppjieba {
 class HMMSegment: public SegmentBase {
@@ -44,12 +48,17 @@ class HMMSegment: public SegmentBase {
     GetWordsFromWordRanges(sentence, wrs, words);
   }
   void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res) const {
+    SegmentScratch scratch;
+    Cut(begin, end, res, scratch);
+  }
+  // only the Viterbi buffers of scratch are used
+  void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, SegmentScratch& scratch) const {
     RuneStrArray::const_iterator left = begin;
     RuneStrArray::const_iterator right = begin;
     while (right != end) {
       if (right->rune < 0x80) {
         if (left != right) {
-          InternalCut(left, right, res);
+          InternalCut(left, right, res, scratch);
         }
         left = right;
         do {
@@ -71,7 +80,7 @@ class HMMSegment: public SegmentBase {
       }
     }
     if (left != right) {
-      InternalCut(left, right, res);
+      InternalCut(left, right, res, scratch);
     }
   }
  private:
@@ -111,9 +120,9 @@ class HMMSegment: public SegmentBase {
     }
     return begin;
   }
-  void InternalCut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res) const {
-    vector<size_t> status;
-    Viterbi(begin, end, status);
+  void InternalCut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, SegmentScratch& scratch) const {
+    vector<size_t>& status = scratch.status;
+    Viterbi(begin, end, status, scratch.path, scratch.weight);
 
     RuneStrArray::const_iterator left = begin;
     RuneStrArray::const_iterator right;
@@ -127,46 +136,42 @@ class HMMSegment: public SegmentBase {
     }
   }
 
+ public:
+  // Time-major layout: the scores of position x are weight[x*4 .. x*4+3] and
+  // path holds the best previous status of each, so a step reads and writes
+  // two adjacent groups of 4 doubles and the emission row of the rune.
   void Viterbi(RuneStrArray::const_iterator begin, 
         RuneStrArray::const_iterator end, 
-        vector<size_t>& status) const {
-    size_t Y = HMMModel::STATUS_SUM;
+        vector<size_t>& status,
+        vector<int>& path,
+        vector<double>& weight) const {
+    const size_t Y = HMMModel::STATUS_SUM;
     size_t X = end - begin;
 
     size_t XYSize = X * Y;
-    size_t now, old, stat;
-    double tmp, endE, endS;
+    size_t stat;
+    double endE, endS;
 
-    vector<int> path(XYSize);
-    vector<double> weight(XYSize);
+    // every cell is written before it is read, so stale contents do not matter
+    if (path.size() < XYSize) {
+      path.resize(XYSize);
+      weight.resize(XYSize);
+    }
 
     //start
+    const EmitRow* emit = &model_->GetEmitRow(begin->rune);
     for (size_t y = 0; y < Y; y++) {
-      weight[0 + y * X] = model_->startProb[y] + model_->GetEmitProb(model_->emitProbVec[y], begin->rune, MIN_DOUBLE);
-      path[0 + y * X] = -1;
+      weight[y] = model_->startProb[y] + emit->prob[y];
+      path[y] = -1;
     }
 
-    double emitProb;
-
     for (size_t x = 1; x < X; x++) {
-      for (size_t y = 0; y < Y; y++) {
-        now = x + y*X;
-        weight[now] = MIN_DOUBLE;
-        path[now] = HMMModel::E; // warning
-        emitProb = model_->GetEmitProb(model_->emitProbVec[y], (begin+x)->rune, MIN_DOUBLE);
-        for (size_t preY = 0; preY < Y; preY++) {
-          old = x - 1 + preY * X;
-          tmp = weight[old] + model_->transProb[preY][y] + emitProb;
-          if (tmp > weight[now]) {
-            weight[now] = tmp;
-            path[now] = preY;
-          }
-        }
-      }
+      emit = &model_->GetEmitRow((begin + x)->rune);
+      ViterbiStep(&weight[(x - 1) * Y], emit->prob, &weight[x * Y], &path[x * Y]);
     }
 
-    endE = weight[X-1+HMMModel::E*X];
-    endS = weight[X-1+HMMModel::S*X];
+    endE = weight[(X - 1) * Y + HMMModel::E];
+    endS = weight[(X - 1) * Y + HMMModel::S];
     stat = 0;
     if (endE >= endS) {
       stat = HMMModel::E;
@@ -177,10 +182,58 @@ class HMMSegment: public SegmentBase {
     status.resize(X);
     for (int x = X -1 ; x >= 0; x--) {
       status[x] = stat;
-      stat = path[x + stat*X];
+      stat = path[x * Y + stat];
     }
   }
 
+ private:
+  // One position: for every status y, the best of prev[preY] + trans[preY][y]
+  // + emit[y]. Previous statuses are tried in order and only a strictly
+  // greater score replaces the best (MIN_DOUBLE, from E), so ties and the
+  // rounding of (weight + trans) + emit are those of the scalar loop.
+  void ViterbiStep(const double* prev, const double* emit, double* cur, int* back) const {
+    const double (*trans)[HMMModel::STATUS_SUM] = model_->transProb;
+#if defined(__SSE2__)
+    // statuses B,E in one register and M,S in the other
+    const __m128d emit01 = _mm_loadu_pd(emit);
+    const __m128d emit23 = _mm_loadu_pd(emit + 2);
+    __m128d best01 = _mm_set1_pd(MIN_DOUBLE);
+    __m128d best23 = best01;
+    __m128d from01 = _mm_set1_pd(HMMModel::E);
+    __m128d from23 = from01;
+    for (int preY = 0; preY < HMMModel::STATUS_SUM; preY++) {
+      const __m128d w = _mm_set1_pd(prev[preY]);
+      const __m128d p = _mm_set1_pd(preY);
+      const __m128d tmp01 = _mm_add_pd(_mm_add_pd(w, _mm_loadu_pd(trans[preY])), emit01);
+      const __m128d tmp23 = _mm_add_pd(_mm_add_pd(w, _mm_loadu_pd(trans[preY] + 2)), emit23);
+      const __m128d gt01 = _mm_cmpgt_pd(tmp01, best01);
+      const __m128d gt23 = _mm_cmpgt_pd(tmp23, best23);
+      best01 = _mm_or_pd(_mm_and_pd(gt01, tmp01), _mm_andnot_pd(gt01, best01));
+      best23 = _mm_or_pd(_mm_and_pd(gt23, tmp23), _mm_andnot_pd(gt23, best23));
+      from01 = _mm_or_pd(_mm_and_pd(gt01, p), _mm_andnot_pd(gt01, from01));
+      from23 = _mm_or_pd(_mm_and_pd(gt23, p), _mm_andnot_pd(gt23, from23));
+    }
+    _mm_storeu_pd(cur, best01);
+    _mm_storeu_pd(cur + 2, best23);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(back), _mm_cvttpd_epi32(from01));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(back + 2), _mm_cvttpd_epi32(from23));
+#else
+    for (int y = 0; y < HMMModel::STATUS_SUM; y++) {
+      double best = MIN_DOUBLE;
+      int from = HMMModel::E;
+      for (int preY = 0; preY < HMMModel::STATUS_SUM; preY++) {
+        double tmp = prev[preY] + trans[preY][y] + emit[y];
+        if (tmp > best) {
+          best = tmp;
+          from = preY;
+        }
+      }
+      cur[y] = best;
+      back[y] = from;
+    }
+#endif
+  }
+
   const HMMModel* model_;
   bool isNeedDestroy_;
 }; // class HMMSegment
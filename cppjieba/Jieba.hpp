@@ -12,8 +12,10 @@ class Jieba {
         const string& model_path = "",
         const string& user_dict_path = "", 
         const string& idf_path = "", 
-        const string& stop_word_path = "") 
-    : dict_trie_(getPath(dict_path, "jieba.dict.utf8"), getPath(user_dict_path, "user.dict.utf8")),
+        const string& stop_word_path = "",
+        const DictTrie::KeyNormalizer* key_normalizer = NULL) 
+    : dict_trie_(getPath(dict_path, "jieba.dict.utf8"), getPath(user_dict_path, "user.dict.utf8"),
+                 DictTrie::WordWeightMedian, key_normalizer),
       model_(getPath(model_path, "hmm_model.utf8")),
       mp_seg_(&dict_trie_),
       hmm_seg_(&model_),
@@ -67,6 +69,42 @@ class Jieba {
   void Tag(const string& sentence, vector<pair<string, string> >& words) const {
     mix_seg_.Tag(sentence, words);
   }
+
+  // Batch entry points for many short sentences. words[i] receives the result
+  // of sentences[i]; all working buffers come from scratch (one per thread),
+  // and the strings of a reused words vector are overwritten in place.
+  void CutBatch(const vector<string>& sentences, vector<vector<string> >& words, SegmentScratch& scratch, bool hmm = true) const {
+    words.resize(sentences.size());
+    for (size_t i = 0; i < sentences.size(); ++i) {
+      mix_seg_.Cut(sentences[i], words[i], hmm, scratch);
+    }
+  }
+  void TagBatch(const vector<string>& sentences, vector<vector<pair<string, string> > >& words, SegmentScratch& scratch) const {
+    words.resize(sentences.size());
+    for (size_t i = 0; i < sentences.size(); ++i) {
+      mix_seg_.Tag(sentences[i], words[i], scratch);
+    }
+  }
+  // single-sentence form of TagBatch: words is overwritten, not appended to
+  void Tag(const string& sentence, vector<pair<string, string> >& words, SegmentScratch& scratch) const {
+    mix_seg_.Tag(sentence, words, scratch);
+  }
+  // Zero-copy tagging: every word is a (byte offset, byte length, tag id)
+  // span of sentence; GetTagName turns the id back into the tag string.
+  void TagSpans(const string& sentence, vector<WordSpan>& spans, SegmentScratch& scratch) const {
+    mix_seg_.TagSpans(sentence, spans, scratch);
+  }
+  const string& GetTagName(TagId id) const {
+    return dict_trie_.GetTagName(id);
+  }
+  // TAG_ID_UNKNOWN if no word has this tag
+  TagId GetTagId(const string& tag) const {
+    return dict_trie_.GetTagId(tag);
+  }
+  size_t GetTagCount() const {
+    return dict_trie_.GetTagCount();
+  }
+
   string LookupTag(const string &str) const {
     return mix_seg_.LookupTag(str);
   }
@@ -57,12 +57,31 @@ class MPSegment: public SegmentTagged {
            vector<WordRange>& words,
            size_t max_word_len = MAX_WORD_LENGTH) const {
     vector<Dag> dags;
+    Cut(begin, end, words, dags, max_word_len);
+  }
+  // dags is only working storage, pass a reused one to avoid reallocating it.
+  // If units is not NULL, the DictUnit chosen for each word (NULL for a single
+  // char that is not a dictionary word) is appended to it alongside words.
+  void Cut(RuneStrArray::const_iterator begin,
+           RuneStrArray::const_iterator end,
+           vector<WordRange>& words,
+           vector<Dag>& dags,
+           size_t max_word_len = MAX_WORD_LENGTH,
+           vector<const DictUnit*>* units = NULL) const {
     dictTrie_->Find(begin, 
           end, 
           dags,
           max_word_len);
     CalcDP(dags);
-    CutByDag(begin, end, dags, words);
+    CutByDag(begin, end, dags, words, units);
+  }
+
+  void CutRanges(const string& sentence, SegmentScratch& scratch) const {
+    Cut(sentence, scratch, NULL);
+  }
+  void CutUnits(const string& sentence, SegmentScratch& scratch) const {
+    scratch.units.clear();
+    Cut(sentence, scratch, &scratch.units);
   }
 
   const DictTrie* GetDictTrie() const {
@@ -77,6 +96,19 @@ class MPSegment: public SegmentTagged {
     return dictTrie_->IsUserDictSingleChineseWord(value);
   }
  private:
+  void Cut(const string& sentence, SegmentScratch& scratch, vector<const DictUnit*>* units) const {
+    PreFilter pre_filter(symbols_, sentence, scratch.runes);
+    PreFilter::Range range;
+    scratch.ranges.clear();
+    while (pre_filter.HasNext()) {
+      range = pre_filter.Next();
+      Cut(range.begin, range.end, scratch.ranges, scratch.dags, MAX_WORD_LENGTH, units);
+    }
+  }
+
+ public:
+  // Best path weight of every DAG position, computed from the end
+  // (hotwords_bench times it separately from the trie lookup).
   void CalcDP(vector<Dag>& dags) const {
     size_t nextPos;
     const DictUnit* p;
@@ -106,13 +138,18 @@ class MPSegment: public SegmentTagged {
       }
     }
   }
+ private:
   void CutByDag(RuneStrArray::const_iterator begin, 
         RuneStrArray::const_iterator end, 
         const vector<Dag>& dags, 
-        vector<WordRange>& words) const {
+        vector<WordRange>& words,
+        vector<const DictUnit*>* units = NULL) const {
     size_t i = 0;
     while (i < dags.size()) {
       const DictUnit* p = dags[i].pInfo;
+      if (units != NULL) {
+        units->push_back(p);
+      }
       if (p) {
         assert(p->word.size() >= 1);
         WordRange wr(begin + i, begin + i + p->word.size() - 1);
@@ -43,22 +43,59 @@ class MixSegment: public SegmentTagged {
     GetWordsFromWordRanges(sentence, wrs, words);
   }
 
+  // Same as Cut(sentence, words, hmm), but all working buffers come from
+  // scratch and the strings of a reused words vector are assigned in place.
+  void Cut(const string& sentence, vector<string>& words, SegmentScratch& scratch) const {
+    Cut(sentence, words, true, scratch);
+  }
+  void Cut(const string& sentence, vector<string>& words, bool hmm, SegmentScratch& scratch) const {
+    CutRanges(sentence, scratch, hmm);
+    GetStringsFromWordRanges(sentence, scratch.ranges, words);
+  }
+  void CutRanges(const string& sentence, SegmentScratch& scratch) const {
+    CutRanges(sentence, scratch, true);
+  }
+  void CutRanges(const string& sentence, SegmentScratch& scratch, bool hmm) const {
+    Cut(sentence, scratch, hmm, NULL);
+  }
+  // Words kept from the MP pass reuse the DictUnit of the DAG; words produced
+  // by HMM are looked up once on their runes (most are not in the dictionary).
+  void CutUnits(const string& sentence, SegmentScratch& scratch) const {
+    scratch.units.clear();
+    Cut(sentence, scratch, true, &scratch.units);
+  }
+
   void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, bool hmm) const {
+    SegmentScratch scratch;
+    Cut(begin, end, res, hmm, scratch);
+  }
+  void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, bool hmm, SegmentScratch& scratch,
+           vector<const DictUnit*>* units = NULL) const {
     if (!hmm) {
-      mpSeg_.Cut(begin, end, res);
+      mpSeg_.Cut(begin, end, res, scratch.dags, MAX_WORD_LENGTH, units);
       return;
     }
-    vector<WordRange> words;
+    vector<WordRange>& words = scratch.mp_words;
+    words.clear();
     assert(end >= begin);
     words.reserve(end - begin);
-    mpSeg_.Cut(begin, end, words);
+    vector<const DictUnit*>* mp_units = NULL;
+    if (units != NULL) {
+      mp_units = &scratch.mp_units;
+      mp_units->clear();
+    }
+    mpSeg_.Cut(begin, end, words, scratch.dags, MAX_WORD_LENGTH, mp_units);
 
-    vector<WordRange> hmmRes;
+    vector<WordRange>& hmmRes = scratch.hmm_words;
+    hmmRes.clear();
     hmmRes.reserve(end - begin);
     for (size_t i = 0; i < words.size(); i++) {
       //if mp Get a word, it's ok, put it into result
       if (words[i].left != words[i].right || (words[i].left == words[i].right && mpSeg_.IsUserDictSingleChineseWord(words[i].left->rune))) {
         res.push_back(words[i]);
+        if (units != NULL) {
+          units->push_back((*mp_units)[i]);
+        }
         continue;
       }
 
@@ -71,10 +108,13 @@ class MixSegment: public SegmentTagged {
       // Cut the sequence with hmm
       assert(j - 1 >= i);
       // TODO
-      hmmSeg_.Cut(words[i].left, words[j - 1].left + 1, hmmRes);
+      hmmSeg_.Cut(words[i].left, words[j - 1].left + 1, hmmRes, scratch);
       //put hmm result to result
       for (size_t k = 0; k < hmmRes.size(); k++) {
         res.push_back(hmmRes[k]);
+        if (units != NULL) {
+          units->push_back(GetDictTrie()->Find(hmmRes[k].left, hmmRes[k].right + 1));
+        }
       }
 
       //clear tmp vars
@@ -93,11 +133,29 @@ class MixSegment: public SegmentTagged {
     return tagger_.Tag(src, res, *this);
   }
 
+  bool Tag(const string& src, vector<pair<string, string> >& res, SegmentScratch& scratch) const {
+    return tagger_.Tag(src, res, *this, scratch);
+  }
+
+  bool TagSpans(const string& src, vector<WordSpan>& res, SegmentScratch& scratch) const {
+    return tagger_.TagSpans(src, res, *this, scratch);
+  }
+
   string LookupTag(const string &str) const {
     return tagger_.LookupTag(str, *this);
   }
 
  private:
+  void Cut(const string& sentence, SegmentScratch& scratch, bool hmm, vector<const DictUnit*>* units) const {
+    PreFilter pre_filter(symbols_, sentence, scratch.runes);
+    PreFilter::Range range;
+    scratch.ranges.clear();
+    while (pre_filter.HasNext()) {
+      range = pre_filter.Next();
+      Cut(range.begin, range.end, scratch.ranges, hmm, scratch, units);
+    }
+  }
+
   MPSegment mpSeg_;
   HMMSegment hmmSeg_;
   PosTagger tagger_;
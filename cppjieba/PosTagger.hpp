@@ -8,10 +8,6 @@
 namespace cppjieba {
 using namespace limonp;
 
-static const char* const POS_M = "m";
-static const char* const POS_ENG = "eng";
-static const char* const POS_X = "x";
-
 class PosTagger {
  public:
   PosTagger() {
@@ -29,8 +25,36 @@ class PosTagger {
     return !res.empty();
   }
 
+  // Overwrites res (the plain Tag appends) so that the strings of a reused
+  // result vector keep their buffers. Tags come from the DictUnit the
+  // segmenter picked for each word, no word is decoded or looked up again.
+  bool Tag(const string& src, vector<pair<string, string> >& res, const SegmentTagged& segment, SegmentScratch& scratch) const {
+    segment.CutUnits(src, scratch);
+    const DictTrie* dict = segment.GetDictTrie();
+    const vector<WordRange>& ranges = scratch.ranges;
+    res.resize(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      uint32_t len = ranges[i].right->offset - ranges[i].left->offset + ranges[i].right->len;
+      res[i].first.assign(src, ranges[i].left->offset, len);
+      res[i].second = dict->GetTagName(GetTagId(scratch.units[i], ranges[i]));
+    }
+    return !res.empty();
+  }
+
+  // Zero-copy form: each word is a byte span of src plus its tag id, the tag
+  // name is dict->GetTagName(tag_id).
+  bool TagSpans(const string& src, vector<WordSpan>& res, const SegmentTagged& segment, SegmentScratch& scratch) const {
+    segment.CutUnits(src, scratch);
+    const vector<WordRange>& ranges = scratch.ranges;
+    res.resize(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      uint32_t len = ranges[i].right->offset - ranges[i].left->offset + ranges[i].right->len;
+      res[i] = WordSpan(ranges[i].left->offset, len, GetTagId(scratch.units[i], ranges[i]));
+    }
+    return !res.empty();
+  }
+
   string LookupTag(const string &str, const SegmentTagged& segment) const {
-    const DictUnit *tmp = NULL;
     RuneStrArray runes;
     const DictTrie * dict = segment.GetDictTrie();
     assert(dict != NULL);
@@ -38,36 +62,46 @@ class PosTagger {
         XLOG(ERROR) << "UTF-8 decode failed for word: " << str;
         return POS_X;
       }
-      tmp = dict->Find(runes.begin(), runes.end());
-      if (tmp == NULL || tmp->tag.empty()) {
-        return SpecialRule(runes);
-      } else {
-        return tmp->tag;
-      }
+      return dict->GetTagName(LookupTagId(runes.begin(), runes.end(), dict));
+  }
+
+  TagId LookupTagId(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, const DictTrie* dict) const {
+    return GetTagId(dict->Find(begin, end), begin, end);
   }
 
  private:
-  const char* SpecialRule(const RuneStrArray& unicode) const {
+  TagId GetTagId(const DictUnit* unit, const WordRange& range) const {
+    return GetTagId(unit, range.left, range.right + 1);
+  }
+  TagId GetTagId(const DictUnit* unit, RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
+    if (unit == NULL || unit->tag.empty()) {
+      return SpecialRule(begin, end);
+    }
+    return unit->tag_id;
+  }
+
+  TagId SpecialRule(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
     size_t m = 0;
     size_t eng = 0;
-    for (size_t i = 0; i < unicode.size() && eng < unicode.size() / 2; i++) {
-      if (unicode[i].rune < 0x80) {
+    size_t size = end - begin;
+    for (size_t i = 0; i < size && eng < size / 2; i++) {
+      if (begin[i].rune < 0x80) {
         eng ++;
-        if ('0' <= unicode[i].rune && unicode[i].rune <= '9') {
+        if ('0' <= begin[i].rune && begin[i].rune <= '9') {
           m++;
         }
       }
     }
     // ascii char is not found
     if (eng == 0) {
-      return POS_X;
+      return TAG_ID_X;
     }
     // all the ascii is number char
     if (m == eng) {
-      return POS_M;
+      return TAG_ID_M;
     }
     // the ascii chars contain english letter
-    return POS_ENG;
+    return TAG_ID_ENG;
   }
 
 }; // class PosTagger
@@ -1,11 +1,56 @@
 #ifndef CPPJIEBA_PRE_FILTER_H
 #define CPPJIEBA_PRE_FILTER_H
 
+#include <algorithm>
+#include <cstring>
 #include "Trie.hpp"
 #include "limonp/Logging.hpp"
 
 namespace cppjieba {
 
+// The sentence separators, tested once per rune of every sentence. ASCII
+// runes are looked up in an exact 128-bit bitmap; other runes first in a
+// 256-bit bitmap of the low bytes of the non-ASCII separators, so that
+// nearly every CJK rune is rejected by one bit test, and only on a hit in
+// the (tiny, sorted) list of non-ASCII separators.
+class SeparatorSet {
+ public:
+  SeparatorSet() {
+    clear();
+  }
+  void clear() {
+    memset(ascii_, 0, sizeof(ascii_));
+    memset(low_byte_, 0, sizeof(low_byte_));
+    others_.clear();
+  }
+  // false if rune was already in the set
+  bool insert(Rune rune) {
+    if (count(rune)) {
+      return false;
+    }
+    if (rune < 0x80) {
+      ascii_[rune >> 6] |= uint64_t(1) << (rune & 63);
+    } else {
+      low_byte_[(rune & 0xff) >> 6] |= uint64_t(1) << (rune & 63);
+      others_.insert(std::lower_bound(others_.begin(), others_.end(), rune), rune);
+    }
+    return true;
+  }
+  bool count(Rune rune) const {
+    if (rune < 0x80) {
+      return (ascii_[rune >> 6] >> (rune & 63)) & 1;
+    }
+    if (!((low_byte_[(rune & 0xff) >> 6] >> (rune & 63)) & 1)) {
+      return false;
+    }
+    return std::binary_search(others_.begin(), others_.end(), rune);
+  }
+ private:
+  uint64_t ascii_[2];
+  uint64_t low_byte_[4];
+  vector<Rune> others_;
+}; // class SeparatorSet
+
 class PreFilter {
  public:
   //TODO use WordRange instead of Range
@@ -14,13 +59,17 @@ class PreFilter {
     RuneStrArray::const_iterator end;
   }; // struct Range
 
-  PreFilter(const unordered_set<Rune>& symbols, 
+  PreFilter(const SeparatorSet& symbols, 
         const string& sentence)
-    : symbols_(symbols) {
-    if (!DecodeUTF8RunesInString(sentence, sentence_)) {
-      XLOG(ERROR) << "UTF-8 decode failed for input sentence"; 
-    }
-    cursor_ = sentence_.begin();
+    : sentence_(own_), symbols_(symbols) {
+    Decode(sentence);
+  }
+  // decode into caller-owned storage, e.g. a SegmentScratch reused across sentences
+  PreFilter(const SeparatorSet& symbols,
+        const string& sentence,
+        RuneStrArray& storage)
+    : sentence_(storage), symbols_(symbols) {
+    Decode(sentence);
   }
   ~PreFilter() {
   }
@@ -31,7 +80,7 @@ class PreFilter {
     Range range;
     range.begin = cursor_;
     while (cursor_ != sentence_.end()) {
-      if (IsIn(symbols_, cursor_->rune)) {
+      if (symbols_.count(cursor_->rune)) {
         if (range.begin == cursor_) {
           cursor_ ++;
         }
@@ -44,9 +93,17 @@ class PreFilter {
     return range;
   }
  private:
+  void Decode(const string& sentence) {
+    if (!DecodeUTF8RunesInString(sentence, sentence_)) {
+      XLOG(ERROR) << "UTF-8 decode failed for input sentence"; 
+    }
+    cursor_ = sentence_.begin();
+  }
+
   RuneStrArray::const_iterator cursor_;
-  RuneStrArray sentence_;
-  const unordered_set<Rune>& symbols_;
+  RuneStrArray own_;
+  RuneStrArray& sentence_;
+  const SeparatorSet& symbols_;
 }; // class PreFilter
 
 } // namespace cppjieba
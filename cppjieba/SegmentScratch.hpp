@@ -0,0 +1,30 @@
+#ifndef CPPJIEBA_SEGMENT_SCRATCH_H
+#define CPPJIEBA_SEGMENT_SCRATCH_H
+
+#include <string>
+#include <vector>
+#include "Unicode.hpp"
+#include "Trie.hpp"
+
+namespace cppjieba {
+
+// Working buffers of the Cut/Tag path. Keep one per thread and pass it to the
+// *Batch entry points of Jieba: every buffer keeps its capacity between
+// sentences, so after warm-up segmenting a short line does not allocate
+// except for the output strings.
+struct SegmentScratch {
+  RuneStrArray runes;            // PreFilter: the decoded sentence
+  vector<WordRange> ranges;      // words of the whole sentence
+  vector<const DictUnit*> units; // CutUnits: dictionary entry of ranges[i], NULL if none
+  vector<WordRange> mp_words;    // MixSegment: MP result of one range
+  vector<const DictUnit*> mp_units;
+  vector<WordRange> hmm_words;   // MixSegment: HMM result of one run of single chars
+  vector<Dag> dags;              // MPSegment: DAG of one range
+  vector<double> weight;         // HMMSegment::Viterbi
+  vector<int> path;
+  vector<size_t> status;
+}; // struct SegmentScratch
+
+} // namespace cppjieba
+
+#endif // CPPJIEBA_SEGMENT_SCRATCH_H
@@ -2,6 +2,7 @@
 #define CPPJIEBA_SEGMENTTAGGED_H
 
 #include "SegmentBase.hpp"
+#include "SegmentScratch.hpp"
 
 namespace cppjieba {
 
@@ -12,8 +13,23 @@ class SegmentTagged : public SegmentBase{
   virtual ~SegmentTagged() {
   }
 
+  using SegmentBase::Cut;
+
   virtual bool Tag(const string& src, vector<pair<string, string> >& res) const = 0;
 
+  // Segment sentence into scratch.ranges, word ranges over scratch.runes.
+  virtual void CutRanges(const string& sentence, SegmentScratch& scratch) const = 0;
+
+  // Same as CutRanges, and also fills scratch.units with the dictionary entry
+  // the segmenter picked for every word, so taggers need no second lookup.
+  virtual void CutUnits(const string& sentence, SegmentScratch& scratch) const = 0;
+
+  // Cut with caller-owned working buffers.
+  void Cut(const string& sentence, vector<string>& words, SegmentScratch& scratch) const {
+    CutRanges(sentence, scratch);
+    GetStringsFromWordRanges(sentence, scratch.ranges, words);
+  }
+
   virtual const DictTrie* GetDictTrie() const = 0;
 
 }; // class SegmentTagged
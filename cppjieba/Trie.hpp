@@ -12,10 +12,13 @@ using namespace std;
 
 const size_t MAX_WORD_LENGTH = 512;
 
+typedef uint16_t TagId;
+
 struct DictUnit {
   Unicode word;
   double weight;
   string tag;
+  TagId tag_id; // id of tag in the owning DictTrie's tag table
 }; // struct DictUnit
 
 // for debugging
@@ -58,6 +61,19 @@ class Trie {
     DeleteNode(root_);
   }
 
+  const TrieNode* Root() const {
+    return root_;
+  }
+
+  // NULL if node has no child for key
+  static const TrieNode* Child(const TrieNode* node, TrieKey key) {
+    if (node == NULL || node->next == NULL) {
+      return NULL;
+    }
+    TrieNode::NextMap::const_iterator citer = node->next->find(key);
+    return citer == node->next->end() ? NULL : citer->second;
+  }
+
   const DictUnit* Find(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
     if (begin == end) {
       return NULL;
@@ -89,6 +105,7 @@ class Trie {
     TrieNode::NextMap::const_iterator citer;
     for (size_t i = 0; i < size_t(end - begin); i++) {
       res[i].runestr = *(begin + i);
+      res[i].nexts.reset(); // res may be a reused buffer
 
       if (root_->next != NULL && root_->next->end() != (citer = root_->next->find(res[i].runestr.rune))) {
         ptNode = citer->second;
@@ -141,34 +158,43 @@ class Trie {
     assert(ptNode != NULL);
     ptNode->ptValue = ptValue;
   }
+  // Remove the value stored for key. Nodes are kept: they may be prefixes of
+  // other keys.
   void DeleteNode(const Unicode& key, const DictUnit* ptValue) {
-      if (key.begin() == key.end()) {
+    (void)ptValue;
+    if (key.begin() == key.end()) {
+      return;
+    }
+    TrieNode *ptNode = root_;
+    for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
+      if (NULL == ptNode->next) {
         return;
       }
-      //定义一个NextMap迭代器
-      TrieNode::NextMap::const_iterator kmIter;
-      //定义一个指向root的TrieNode指针
-      TrieNode *ptNode = root_;
-      for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
-        //链表不存在元素
-        if (NULL == ptNode->next) {
-          return;
-        }
-        kmIter = ptNode->next->find(*citer);
-        //如果map中不存在,跳出循环
-        if (ptNode->next->end() == kmIter) {
-              break;
-        }
-        //从unordered_map中擦除该项
-        ptNode->next->erase(*citer);
-        //删除该node
-        ptNode = kmIter->second;
-        delete ptNode;
-        break;
+      TrieNode::NextMap::const_iterator kmIter = ptNode->next->find(*citer);
+      if (ptNode->next->end() == kmIter) {
+        return;
       }
-      return;
- }
+      ptNode = kmIter->second;
+    }
+    ptNode->ptValue = NULL;
+  }
+  // estimated heap bytes of the nodes and their child maps
+  size_t MemoryBytes() const {
+    return NodeBytes(root_);
+  }
  private:
+  static size_t NodeBytes(const TrieNode* node) {
+    size_t bytes = sizeof(TrieNode);
+    if (node->next != NULL) {
+      bytes += sizeof(TrieNode::NextMap) + node->next->bucket_count() * sizeof(void*)
+        + node->next->size() * (sizeof(TrieNode::NextMap::value_type) + sizeof(void*));
+      for (TrieNode::NextMap::const_iterator it = node->next->begin(); it != node->next->end(); ++it) {
+        bytes += NodeBytes(it->second);
+      }
+    }
+    return bytes;
+  }
+
   void CreateTrie(const vector<Unicode>& keys, const vector<const DictUnit*>& valuePointers) {
     if (valuePointers.empty() || keys.empty()) {
       return;
@@ -6,6 +6,9 @@
 #include <string>
 #include <vector>
 #include <ostream>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "limonp/LocalVector.hpp"
 
 namespace cppjieba {
@@ -32,6 +35,19 @@ inline std::ostream& operator << (std::ostream& os, const Word& w) {
   return os << "{\"word\": \"" << w.word << "\", \"offset\": " << w.offset << "}";
 }
 
+// A word as a byte range of the segmented sentence plus its tag id; the
+// zero-copy counterpart of Word / pair<string, string>.
+struct WordSpan {
+  uint32_t offset;
+  uint32_t len;
+  uint16_t tag_id;
+  WordSpan(): offset(0), len(0), tag_id(0) {
+  }
+  WordSpan(uint32_t o, uint32_t l, uint16_t t)
+    : offset(o), len(l), tag_id(t) {
+  }
+}; // struct WordSpan
+
 struct RuneStr {
   Rune rune;
   uint32_t offset;
@@ -139,20 +155,61 @@ inline RuneStrLite DecodeUTF8ToRune(const char* str, size_t len) {
   return rp;
 }
 
+// Length of the run of ASCII bytes at the start of s (at most len).
+inline size_t AsciiPrefixLength(const char* s, size_t len) {
+  size_t n = 0;
+#if defined(__SSE2__)
+  // 16 bytes per step: a byte is ASCII iff its top bit, gathered by movemask, is 0
+  while (n + 16 <= len) {
+    int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + n)));
+    if (mask != 0) {
+      return n + __builtin_ctz(mask);
+    }
+    n += 16;
+  }
+#endif
+  while (n < len && !(s[n] & 0x80)) {
+    n++;
+  }
+  return n;
+}
+
+// Accepts and decodes exactly what DecodeUTF8ToRune does, rune by rune, but
+// emits ASCII runs and 3-byte sequences (CJK) without the general decoder.
 inline bool DecodeUTF8RunesInString(const char* s, size_t len, RuneStrArray& runes) {
-  runes.clear();
-  runes.reserve(len / 2);
-  for (uint32_t i = 0, j = 0; i < len;) {
-    RuneStrLite rp = DecodeUTF8ToRune(s + i, len - i);
-    if (rp.len == 0) {
-      runes.clear();
-      return false;
+  runes.reset(); // keeps the storage of a reused array
+  runes.resize(len); // at most one rune per byte, shrunk below
+  RuneStr* out = len ? &runes[0] : NULL;
+  uint32_t i = 0, j = 0;
+  while (i < len) {
+    uint8_t c = (uint8_t)s[i];
+    if (c < 0x80) {
+      uint32_t n = (uint32_t)AsciiPrefixLength(s + i, len - i);
+      for (uint32_t k = 0; k < n; k++) {
+        out[j + k] = RuneStr((uint8_t)s[i + k], i + k, 1, j + k, 1);
+      }
+      i += n;
+      j += n;
+    } else if (c >= 0xe0 && c <= 0xef && len - i > 2) {
+      // CJK text is long runs of 3-byte sequences
+      do {
+        Rune r = ((Rune)(c & 0x0f) << 12) | ((Rune)((uint8_t)s[i + 1] & 0x3f) << 6) | ((uint8_t)s[i + 2] & 0x3f);
+        out[j] = RuneStr(r, i, 3, j, 1);
+        i += 3;
+        ++j;
+      } while (len - i > 2 && (c = (uint8_t)s[i]) >= 0xe0 && c <= 0xef);
+    } else {
+      RuneStrLite rp = DecodeUTF8ToRune(s + i, len - i);
+      if (rp.len == 0) {
+        runes.clear();
+        return false;
+      }
+      out[j] = RuneStr(rp.rune, i, rp.len, j, 1);
+      i += rp.len;
+      ++j;
     }
-    RuneStr x(rp.rune, i, rp.len, j, 1);
-    runes.push_back(x);
-    i += rp.len;
-    ++j;
   }
+  runes.resize(j);
   return true;
 }
 
@@ -215,6 +272,16 @@ inline vector<Word> GetWordsFromWordRanges(const string& s, const vector<WordRan
   return result;
 }
 
+// Fill strs from word ranges, assigning into the existing strings so that a
+// reused output vector keeps their buffers.
+inline void GetStringsFromWordRanges(const string& s, const vector<WordRange>& wrs, vector<string>& strs) {
+  strs.resize(wrs.size());
+  for (size_t i = 0; i < wrs.size(); ++i) {
+    uint32_t len = wrs[i].right->offset - wrs[i].left->offset + wrs[i].right->len;
+    strs[i].assign(s, wrs[i].left->offset, len);
+  }
+}
+
 inline void GetStringsFromWords(const vector<Word>& words, vector<string>& strs) {
   strs.resize(words.size());
   for (size_t i = 0; i < words.size(); ++i) {
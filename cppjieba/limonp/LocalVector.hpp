@@ -119,6 +119,15 @@ class LocalVector {
     }
     init_();
   }
+  // drop the elements but keep the storage, for buffers reused across calls
+  void reset() {
+    size_ = 0;
+  }
+  // new elements are left uninitialized, to be written through operator []
+  void resize(size_t size) {
+    reserve(size);
+    size_ = size;
+  }
 };
 
 template <class T>
@@ -0,0 +1,442 @@
+// hotwords_bench: repeatable benchmarks of the segmenter components and of the
+// whole file mode pipeline on input/input1-3.txt, with no outside tools.
+// Usage: hotwords_bench [--repeat N] [--filter NAME] [--threads N]
+//                       [--out FILE] [--compare OLD_FILE]
+// Every suite runs once to warm up and then N times (default 5); the table on
+// stdout and the JSON file (default output/bench.json) report the fastest,
+// median and mean run. --compare prints the median of each suite against a
+// JSON file written by an earlier run.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <thread>
+#include "engine.hpp"
+#include "memory_stats.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int kTopK = 10;       // fixed, so results do not depend on config.ini
+const int kTimeRange = 5;   // minutes
+const long long kDaySeconds = 86400;
+
+struct BenchOptions {
+    int repeat = 5;
+    std::string filter;
+    size_t threads = 0;     // 0 = one per hardware thread
+    std::string out = std::string(OUTPUT_ROOT_DIR) + "/bench.json";
+    std::string compare;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string unit;       // what `items` counts
+    size_t items = 0;       // processed per run
+    std::vector<long long> runs_ns;
+
+    long long min_ns() const { return *std::min_element(runs_ns.begin(), runs_ns.end()); }
+    long long median_ns() const {
+        std::vector<long long> v(runs_ns);
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        return v[v.size() / 2];
+    }
+    double mean_ns() const {
+        double sum = 0;
+        for (long long ns : runs_ns) sum += static_cast<double>(ns);
+        return sum / runs_ns.size();
+    }
+    double ns_per_item() const { return items ? static_cast<double>(median_ns()) / items : 0.0; }
+    double items_per_sec() const { return median_ns() > 0 ? items * 1e9 / median_ns() : 0.0; }
+};
+
+// Results folded into this are printed, so no benchmarked work is optimized away.
+size_t g_sink = 0;
+
+template <class Fn>
+long long time_ns(Fn fn) {
+    auto t0 = Clock::now();
+    fn();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+}
+
+// Inputs shared by the suites, prepared once, untimed.
+struct Corpus {
+    std::vector<std::string> files;           // input/input1-3.txt
+    std::vector<std::string> sentences;       // normalized sentences of the data lines
+    std::vector<long long> times;             // event time of sentences[i], files placed on consecutive days
+    std::vector<cppjieba::RuneStrArray> runes; // sentences[i] decoded
+    size_t bytes = 0;
+    size_t rune_count = 0;
+    // token stream of all sentences: words of sentences[i] are tokens[line_end[i-1], line_end[i])
+    std::vector<WordId> tokens;
+    std::vector<size_t> line_end;
+};
+
+// The app's settings with the bench's fixed Top-K and window.
+Config bench_config() {
+    Config cfg{};
+    cfg.topk = kTopK;
+    cfg.time_range = kTimeRange;
+    cfg.normalize = true;
+    return cfg;
+}
+
+// Data lines parsed as the engine parses them, words interned into its vocab.
+bool load_corpus(HotWordsEngine& engine, Corpus& c) {
+    Vocab& vocab = engine.counter().vocab();
+    cppjieba::SegmentScratch scratch;
+    ParsedLine pl;
+    std::string contents;
+    for (int f = 1; f <= 3; ++f) {
+        std::string path = std::string(INPUT_ROOT_DIR) + "/input" + std::to_string(f) + ".txt";
+        LineReader reader;
+        if (!reader.Open(path)) {
+            std::cerr << "[ERROR] cannot open input file: " << path << std::endl;
+            return false;
+        }
+        c.files.push_back(path);
+        std::string_view line;
+        while (reader.Next(line)) {
+            contents.assign(line.data(), line.size());
+            engine.Parse(contents, pl, scratch);
+            if (pl.kind != ParsedLine::kData) continue;
+            for (size_t i = 0; i < pl.spans.size(); ++i) {
+                WordId id = vocab.Intern(pl.word(i), pl.spans[i].tag_id);
+                if (!vocab.Filtered(id)) c.tokens.push_back(id);
+            }
+            c.line_end.push_back(c.tokens.size());
+            c.sentences.push_back(pl.sentence);
+            c.times.push_back((f - 1) * kDaySeconds + pl.value);
+            c.bytes += pl.sentence.size();
+        }
+        reader.Close();
+    }
+    c.runes.resize(c.sentences.size());
+    for (size_t i = 0; i < c.sentences.size(); ++i) {
+        cppjieba::DecodeUTF8RunesInString(c.sentences[i], c.runes[i]);
+        c.rune_count += c.runes[i].size();
+    }
+    return !c.sentences.empty();
+}
+
+class BenchRunner {
+ public:
+    explicit BenchRunner(const BenchOptions& opt) : opt_(opt) {}
+
+    // fn() runs the suite once and returns the nanoseconds of the measured part.
+    template <class Fn>
+    void Run(const std::string& name, const std::string& unit, size_t items, Fn fn) {
+        if (!opt_.filter.empty() && name.find(opt_.filter) == std::string::npos) return;
+        BenchResult r;
+        r.name = name;
+        r.unit = unit;
+        r.items = items;
+        fn(); // warm up caches and scratch buffers
+        for (int i = 0; i < opt_.repeat; ++i) r.runs_ns.push_back(fn());
+        std::cout << std::left << std::setw(22) << r.name << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(2) << r.median_ns() / 1e6 << " ms"
+                  << std::setw(12) << std::setprecision(1) << r.ns_per_item() << " ns/" << std::left << std::setw(6) << unit
+                  << std::right << std::setw(14) << std::setprecision(0) << r.items_per_sec() << " " << unit << "/s"
+                  << std::endl;
+        results_.push_back(std::move(r));
+    }
+
+    const std::vector<BenchResult>& results() const { return results_; }
+
+ private:
+    const BenchOptions& opt_;
+    std::vector<BenchResult> results_;
+};
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+// One result object per line, so --compare can read the file back without a
+// JSON library.
+bool write_json(const std::string& path, const BenchOptions& opt, const Corpus& c,
+                const std::vector<BenchResult>& results) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) return false;
+    out << "{\n";
+    out << "  \"timestamp\": " << static_cast<long long>(std::time(nullptr)) << ",\n";
+#if defined(__VERSION__)
+    out << "  \"compiler\": \"" << json_escape(__VERSION__) << "\",\n";
+#endif
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"repeat\": " << opt.repeat << ",\n";
+    out << "  \"peak_rss_mb\": " << get_process_memory().peak_mb << ",\n";
+    out << "  \"inputs\": [";
+    for (size_t i = 0; i < c.files.size(); ++i) out << (i ? ", " : "") << "\"" << json_escape(c.files[i]) << "\"";
+    out << "],\n";
+    out << "  \"sentences\": " << c.sentences.size() << ", \"bytes\": " << c.bytes
+        << ", \"runes\": " << c.rune_count << ", \"tokens\": " << c.tokens.size() << ",\n";
+    out << "  \"results\": [\n";
+    out << std::fixed;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"items\": " << r.items
+            << ", \"min_ns\": " << r.min_ns() << ", \"median_ns\": " << r.median_ns()
+            << ", \"mean_ns\": " << std::setprecision(0) << r.mean_ns()
+            << ", \"ns_per_item\": " << std::setprecision(3) << r.ns_per_item()
+            << ", \"items_per_sec\": " << std::setprecision(1) << r.items_per_sec() << ", \"runs_ns\": [";
+        for (size_t j = 0; j < r.runs_ns.size(); ++j) out << (j ? ", " : "") << r.runs_ns[j];
+        out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+// name -> median_ns of a file written by write_json
+std::unordered_map<std::string, long long> read_medians(const std::string& path) {
+    std::unordered_map<std::string, long long> medians;
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    const std::string name_key = "\"name\": \"";
+    const std::string median_key = "\"median_ns\": ";
+    while (std::getline(in, line)) {
+        size_t n = line.find(name_key);
+        size_t m = line.find(median_key);
+        if (n == std::string::npos || m == std::string::npos) continue;
+        n += name_key.size();
+        std::string name = line.substr(n, line.find('"', n) - n);
+        medians[name] = std::atoll(line.c_str() + m + median_key.size());
+    }
+    return medians;
+}
+
+void print_comparison(const std::string& path, const std::vector<BenchResult>& results) {
+    std::unordered_map<std::string, long long> old = read_medians(path);
+    if (old.empty()) {
+        std::cerr << "[WARNING] no results to compare in " << path << std::endl;
+        return;
+    }
+    std::cout << "\nmedian vs " << path << " (ratio < 1 is faster)\n";
+    for (const BenchResult& r : results) {
+        auto it = old.find(r.name);
+        std::cout << std::left << std::setw(22) << r.name << std::right;
+        if (it == old.end() || it->second <= 0) {
+            std::cout << std::setw(12) << "new" << std::endl;
+            continue;
+        }
+        std::cout << std::setw(12) << std::fixed << std::setprecision(2) << it->second / 1e6 << " ms ->"
+                  << std::setw(10) << r.median_ns() / 1e6 << " ms"
+                  << std::setw(10) << std::setprecision(3) << static_cast<double>(r.median_ns()) / it->second << "x"
+                  << std::endl;
+    }
+}
+
+// The file mode through a fresh engine, without writing the output. The
+// engine is built by the caller, outside the timed region: its constructor
+// reads the stop word, sensitive word and tag files.
+size_t run_file_mode(HotWordsEngine& engine, const std::string& path, size_t threads) {
+    LineReader reader;
+    if (!reader.Open(path)) return 0;
+    size_t sink = 0;
+    engine.IngestStream(reader, threads, [&](const ParsedLine& pl, size_t) {
+        if (pl.kind != ParsedLine::kQuery) return;
+        for (const auto& t : engine.top()) sink += t.first + t.second;
+    });
+    reader.Close();
+    return sink + engine.counter().vocab().Size();
+}
+
+int parse_args(int argc, char** argv, BenchOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "usage: hotwords_bench [--repeat N] [--filter NAME] [--threads N] [--out FILE] [--compare OLD_FILE]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::string value = argv[++i];
+        if (arg == "--repeat") opt.repeat = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--filter") opt.filter = value;
+        else if (arg == "--threads") opt.threads = static_cast<size_t>(std::max(0, std::atoi(value.c_str())));
+        else if (arg == "--out") opt.out = value;
+        else if (arg == "--compare") opt.compare = value;
+        else {
+            std::cerr << "[ERROR] unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    if (parse_args(argc, argv, opt) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    std::string mainDict = std::string(JIEBA_DICT_DIR) + "/jieba.dict.utf8";
+    std::string hmmModel = std::string(JIEBA_DICT_DIR) + "/hmm_model.utf8";
+    std::string userDict = std::string(JIEBA_DICT_DIR) + "/user.dict.utf8";
+    std::string idfFile  = std::string(JIEBA_DICT_DIR) + "/idf.utf8";
+    std::string stopFile = std::string(JIEBA_DICT_DIR) + "/stop_words.utf8";
+    cppjieba::Jieba jieba(mainDict, hmmModel, userDict, idfFile, stopFile, &kDictKeyNormalizer);
+    std::vector<std::string> userterms_vec;
+    ReadUtf8Lines(std::string(INPUT_ROOT_DIR) + "/user_word.txt", userterms_vec);
+    for (auto& word : userterms_vec) jieba.InsertUserWord(word, 20000);
+
+    // the corpus is interned into the vocab of the counter that later serves
+    // the query suites; counting and eviction alone never read the vocab
+    HotWordsEngine query_engine(jieba, bench_config());
+    HotWordCounter& counter = query_engine.counter();
+    Corpus c;
+    if (!load_corpus(query_engine, c)) return EXIT_FAILURE;
+    std::cout << c.sentences.size() << " sentences, " << c.bytes << " bytes, " << c.rune_count << " runes, "
+              << c.tokens.size() << " counted tokens; repeat " << opt.repeat << "\n" << std::endl;
+
+    BenchRunner bench(opt);
+    const cppjieba::DictTrie* dict = jieba.GetDictTrie();
+    cppjieba::MPSegment mp(dict);
+    cppjieba::HMMSegment hmm(jieba.GetHMMModel());
+    cppjieba::MixSegment mix(dict, jieba.GetHMMModel());
+    cppjieba::PosTagger tagger;
+    cppjieba::SegmentScratch scratch;
+
+    // ---- segmenter components ----
+    bench.Run("utf8_decode", "byte", c.bytes, [&] {
+        return time_ns([&] {
+            for (const std::string& s : c.sentences) {
+                cppjieba::DecodeUTF8RunesInString(s, scratch.runes);
+                g_sink += scratch.runes.size();
+            }
+        });
+    });
+    bench.Run("trie_find", "rune", c.rune_count, [&] {
+        return time_ns([&] {
+            for (const auto& r : c.runes) {
+                dict->Find(r.begin(), r.end(), scratch.dags);
+                g_sink += scratch.dags.size();
+            }
+        });
+    });
+    // the DAG of each sentence is rebuilt untimed, only the DP is measured
+    bench.Run("mp_calc_dp", "rune", c.rune_count, [&] {
+        long long ns = 0;
+        for (const auto& r : c.runes) {
+            dict->Find(r.begin(), r.end(), scratch.dags);
+            ns += time_ns([&] { mp.CalcDP(scratch.dags); });
+            if (!scratch.dags.empty()) g_sink += scratch.dags[0].pInfo != NULL;
+        }
+        return ns;
+    });
+    bench.Run("hmm_viterbi", "rune", c.rune_count, [&] {
+        return time_ns([&] {
+            for (const auto& r : c.runes) {
+                if (r.empty()) continue;
+                hmm.Viterbi(r.begin(), r.end(), scratch.status, scratch.path, scratch.weight);
+                g_sink += scratch.status.back();
+            }
+        });
+    });
+    bench.Run("mix_segment", "byte", c.bytes, [&] {
+        return time_ns([&] {
+            for (const std::string& s : c.sentences) {
+                mix.CutUnits(s, scratch);
+                g_sink += scratch.ranges.size();
+            }
+        });
+    });
+    // segmentation plus tagging; the difference to mix_segment is the tagger
+    std::vector<cppjieba::WordSpan> spans;
+    bench.Run("pos_tagger", "byte", c.bytes, [&] {
+        return time_ns([&] {
+            for (const std::string& s : c.sentences) {
+                tagger.TagSpans(s, spans, mix, scratch);
+                g_sink += spans.size();
+            }
+        });
+    });
+
+    // ---- counting, eviction and queries on the pre-segmented token stream ----
+    // Feed the whole stream, line by line as the file mode does; returns the
+    // time spent in either the counting or the eviction half.
+    auto feed = [&](HotWordCounter& target, bool time_evict) {
+        long long count_ns = 0, evict_ns = 0;
+        size_t begin = 0;
+        for (size_t i = 0; i < c.line_end.size(); ++i) {
+            long long t = c.times[i];
+            size_t end = c.line_end[i];
+            count_ns += time_ns([&] {
+                target.Observe(t);
+                for (size_t k = begin; k < end; ++k) target.Add(t, c.tokens[k]);
+            });
+            evict_ns += time_ns([&] { target.Evict(); });
+            begin = end;
+        }
+        g_sink += target.current_time();
+        return time_evict ? evict_ns : count_ns;
+    };
+    bench.Run("count", "token", c.tokens.size(), [&] {
+        HotWordCounter fresh(kTimeRange);
+        return feed(fresh, false);
+    });
+    bench.Run("evict", "line", c.line_end.size(), [&] {
+        HotWordCounter fresh(kTimeRange);
+        return feed(fresh, true);
+    });
+
+    feed(counter, false);
+    std::vector<std::pair<WordId, int>> top;
+    const size_t kQueries = 2000;
+    bench.Run("query_current", "query", kQueries, [&] {
+        long long minute = counter.current_time() / 60;
+        return time_ns([&] {
+            for (size_t q = 0; q < kQueries; ++q) {
+                counter.TopK(minute, kTopK, top);
+                g_sink += top.size();
+            }
+        });
+    });
+    // minutes spread evenly over the whole history, none of them the current one
+    bench.Run("query_history", "query", kQueries, [&] {
+        long long minutes = std::max<long long>(counter.current_time() / 60, 1); // short corpora end in minute 0
+        return time_ns([&] {
+            for (size_t q = 0; q < kQueries; ++q) {
+                counter.TopK(static_cast<long long>(q * 7919 % minutes), kTopK, top);
+                g_sink += top.size();
+            }
+        });
+    });
+
+    // ---- end to end, as the file mode runs (without writing the output) ----
+    size_t threads = resolve_thread_count(static_cast<int>(opt.threads));
+    for (size_t f = 0; f < c.files.size(); ++f) {
+        LineReader counter_lines;
+        size_t lines = 0;
+        std::string_view line;
+        if (counter_lines.Open(c.files[f])) {
+            while (counter_lines.Next(line)) ++lines;
+        }
+        std::string name = "e2e_input" + std::to_string(f + 1);
+        bench.Run(name, "line", lines, [&] {
+            HotWordsEngine engine(jieba, bench_config());
+            return time_ns([&] { g_sink += run_file_mode(engine, c.files[f], 1); });
+        });
+        if (threads > 1) {
+            bench.Run(name + "_mt" + std::to_string(threads), "line", lines, [&] {
+                HotWordsEngine engine(jieba, bench_config());
+                return time_ns([&] { g_sink += run_file_mode(engine, c.files[f], threads); });
+            });
+        }
+    }
+
+    std::cout << "\nchecksum " << g_sink << std::endl;
+    if (!write_json(opt.out, opt, c, bench.results())) {
+        std::cerr << "[ERROR] cannot write " << opt.out << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "results written to " << opt.out << std::endl;
+    if (!opt.compare.empty()) print_comparison(opt.compare, bench.results());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+// Precompile the jieba dictionary (main + user dictionary) into the binary
+// image that DictTrie maps at startup instead of parsing the text files.
+// Usage: hotwords_dict [dict_path] [user_dict_paths]
+// Rerun after editing a dictionary; a stale image is ignored, not used.
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include "utils.hpp" // kDictKeyNormalizer, the key folding the app loads the image with
+
+int main(int argc, char** argv) {
+    std::string dictPath = argc > 1 ? argv[1] : std::string(JIEBA_DICT_DIR) + "/jieba.dict.utf8";
+    std::string userDict = argc > 2 ? argv[2] : std::string(JIEBA_DICT_DIR) + "/user.dict.utf8";
+    std::string imagePath = cppjieba::DictTrie::ImagePath(dictPath);
+
+    // a previous image would be loaded instead of the text we want to compile
+    std::remove(imagePath.c_str());
+
+    auto t0 = std::chrono::steady_clock::now();
+    cppjieba::DictTrie trie(dictPath, userDict, cppjieba::DictTrie::WordWeightMedian, &kDictKeyNormalizer);
+    auto t1 = std::chrono::steady_clock::now();
+    if (!trie.SaveImage(imagePath)) {
+        std::cerr << "[ERROR] cannot write dictionary image: " << imagePath << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    cppjieba::DictTrie check(dictPath, userDict, cppjieba::DictTrie::WordWeightMedian, &kDictKeyNormalizer);
+    auto t3 = std::chrono::steady_clock::now();
+    if (!check.LoadedFromImage()) {
+        std::cerr << "[ERROR] written image does not load: " << imagePath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto ms = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+    std::cout << "image: " << imagePath << "\n"
+              << "text load: " << ms(t1 - t0) << " ms, write: " << ms(t2 - t1)
+              << " ms, image load: " << ms(t3 - t2) << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "engine.hpp"
+#include <algorithm>
+#include <limits>
+#include "memory_stats.hpp"
+
+// 允许词性 (tag.txt 或调用方给出的列表) 转为按词性 id 的表；未出现过的词性不会匹配任何词
+static std::vector<uint8_t> resolve_allowed_tags(const cppjieba::Jieba& jieba, const std::unordered_set<std::string>& tags) {
+    if (tags.empty()) return {};
+    std::vector<uint8_t> allowed(jieba.GetTagCount(), 0);
+    for (const auto& tag : tags) {
+        cppjieba::TagId id = jieba.GetTagId(tag);
+        if (jieba.GetTagName(id) == tag) allowed[id] = 1;
+    }
+    return allowed;
+}
+
+// 窗口大小至少 1 分钟，且不超过 int 范围 (超大的值等同于覆盖全部历史)
+static int clamp_window(ll minutes) {
+    return static_cast<int>(std::min<ll>(std::max<ll>(minutes, 1), std::numeric_limits<int>::max()));
+}
+
+HotWordsEngine::HotWordsEngine(const cppjieba::Jieba& jieba, const Config& cfg)
+    : jieba_(jieba), topk_(cfg.topk > 0 ? static_cast<size_t>(cfg.topk) : 0), counter_(cfg.time_range) {
+    // 停用词/敏感词与允许词性在启动时一次性解析进词表：停用词预先登记并打上标记，
+    // 之后每个词只需检查词表项的 flags
+    std::unordered_set<std::string> tag_allowed_set;
+    scan_tag_allowed(tag_allowed_set);
+    counter_.vocab().SetAllowedTags(resolve_allowed_tags(jieba_, tag_allowed_set));
+
+    std::unordered_set<std::string> stop_words_set;
+    scan_stop_words(stop_words_set);
+    scan_sensitive_words(stop_words_set);
+    for (const auto& w : stop_words_set) counter_.vocab().AddStopWord(w);
+
+    // sensitive_filter 为 mask/drop 时，用敏感词构建的 Aho-Corasick 自动机在分词前扫描整句
+    opt_.nfc = cfg.normalize;
+    opt_.sensitive = parse_sensitive_filter(cfg.sensitive_filter);
+    if (opt_.sensitive != SensitiveFilter::kToken) {
+        std::unordered_set<std::string> words;
+        scan_sensitive_words(words);
+        phrases_.Build(std::vector<std::string>(words.begin(), words.end()));
+        opt_.phrases = &phrases_;
+    }
+}
+
+void HotWordsEngine::SetAllowedTags(const std::vector<std::string>& tags) {
+    counter_.vocab().SetAllowedTags(resolve_allowed_tags(jieba_, std::unordered_set<std::string>(tags.begin(), tags.end())));
+}
+
+void HotWordsEngine::Commit(const ParsedLine& pl) {
+    StageTimes times = pl.times; // 解析阶段的耗时，再加上提交阶段
+    StageTimer timer;
+    switch (pl.kind) {
+    case ParsedLine::kWindowSize:
+        // 变更窗口后，基于历史立即重建当前窗口的计数与索引，确保随后的查询生效
+        counter_.SetTimeRange(clamp_window(pl.value));
+        timer.Lap(times, kStageEvict);
+        latency_.Record(times);
+        return;
+    case ParsedLine::kNoTime:
+    case ParsedLine::kOutOfRange:
+        return;
+    case ParsedLine::kData:
+    case ParsedLine::kUntimed: {
+        ll event_time = pl.value;
+        if (pl.kind == ParsedLine::kData) {
+            counter_.Observe(event_time);
+        } else {
+            event_time = counter_.current_time(); // 无时间戳：使用当前时间
+        }
+
+        // 分词结果是句子内的 (偏移, 长度, 词性id)，直接以 string_view 查词表，不为每个词分配
+        Vocab& vocab = counter_.vocab();
+        ids_.clear();
+        for (size_t i = 0; i < pl.spans.size(); ++i) {
+            WordId id = vocab.Intern(pl.word(i), pl.spans[i].tag_id);
+            if (vocab.Filtered(id)) continue; // 停用词/敏感词/非允许词性
+            ids_.push_back(id);
+        }
+        timer.Lap(times, kStageFilter);
+        for (WordId id : ids_) counter_.Add(event_time, id);
+        timer.Lap(times, kStageCount);
+
+        // 维护滑动窗口 (移除过期数据，按时间有序淘汰，支持迟到/乱序)
+        counter_.Evict();
+        timer.Lap(times, kStageEvict);
+        break;
+    }
+    case ParsedLine::kQuery:
+        // 查询“当前分钟”读实时窗口，其余时刻按历史统计
+        counter_.TopK(pl.value, topk_, top_);
+        timer.Lap(times, kStageQuery);
+        break;
+    }
+    Finish(times);
+}
+
+const HotWordsEngine::TopList& HotWordsEngine::Query(long long minute, size_t k) {
+    StageTimes times;
+    StageTimer timer;
+    counter_.TopK(minute, k, top_);
+    timer.Lap(times, kStageQuery);
+    Finish(times);
+    return top_;
+}
+
+void HotWordsEngine::SetWindowSize(long long minutes) {
+    StageTimes times;
+    StageTimer timer;
+    counter_.SetTimeRange(clamp_window(minutes));
+    timer.Lap(times, kStageEvict);
+    latency_.Record(times);
+}
+
+void HotWordsEngine::Finish(const StageTimes& times) {
+    processed_lines_++;
+    processing_ns_ += times.Total();
+    latency_.Record(times);
+}
+
+void HotWordsEngine::WriteTop(std::ostream& out) const {
+    const Vocab& vocab = counter_.vocab();
+    for (size_t i = 0; i < top_.size(); ++i) {
+        out << i + 1 << ": " << vocab.Word(top_[i].first) << "/" << jieba_.GetTagName(vocab.Tag(top_[i].first)) << "/" << top_[i].second << "\n";
+    }
+}
+
+void HotWordsEngine::WriteLineResult(std::ostream& out, const ParsedLine& pl, size_t line) const {
+    switch (pl.kind) {
+    case ParsedLine::kWindowSize:
+        // 仅修改窗口，不进行查询
+        out << "[INFO] time_range updated to " << counter_.time_range() << " min\n";
+        break;
+    case ParsedLine::kNoTime:
+        out << "[WARNING] Line " << line + 1 << ": cannot extract valid time info.\n";
+        break;
+    case ParsedLine::kOutOfRange:
+        out << "[WARNING] Line " << line + 1 << ": time " << pl.h << ":" << pl.m << ":" << pl.s << " is out of range.\n";
+        break;
+    case ParsedLine::kQuery:
+        out << "Query Time: " << pl.value << " minute" << "\n";
+        WriteTop(out);
+        break;
+    default:
+        break;
+    }
+}
+
+void HotWordsEngine::WriteMetrics(std::ostream& out, long long lines, double seconds, const std::string& outputpath) const {
+    double avg_latency_ms = lines > 0 ? (processing_ns_ / 1e6 / lines) : 0.0;
+    double throughput_lps = seconds > 0 ? (static_cast<double>(lines) / seconds) : 0.0;
+    out << "Program Metrics" << "\n";
+    out << "Throughput(lines/sec): " << throughput_lps << "\n";
+    out << "AvgLatency(ms/line): " << avg_latency_ms << "\n";
+    write_memory_report(out, jieba_, counter_);
+
+    // 阶段耗时直方图：表格追加到输出文件末尾，同样的数据另存为 <输出文件名>_latency.json
+    latency_.WriteReport(out);
+    size_t slash = outputpath.find_last_of("/\\");
+    size_t dot = outputpath.rfind('.');
+    bool has_ext = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    std::string jsonpath = (has_ext ? outputpath.substr(0, dot) : outputpath) + "_latency.json";
+    if (!latency_.WriteJson(jsonpath)) {
+        std::cerr << "[WARNING] cannot write latency report: " << jsonpath << std::endl;
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+// HotWordsEngine: the hot word pipeline behind every front end (file and
+// console mode, the benchmarks and the tests). Lines go in one at a time, as
+// a batch, or as a whole stream through the LinePipeline; the engine filters
+// and counts their words, keeps the sliding window, answers queries and keeps
+// the throughput / latency metrics. Parse() only reads shared state and may
+// run on any thread; everything else belongs to the thread that owns the
+// engine.
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "utils.hpp"
+#include "line_reader.hpp"
+#include "pipeline.hpp"
+#include "phrase_matcher.hpp"
+#include "hot_counter.hpp"
+#include "latency_stats.hpp"
+
+class HotWordsEngine {
+ public:
+    using TopList = std::vector<std::pair<WordId, int>>; // (word id, count), highest first
+
+    // Uses cfg.time_range, topk, normalize and sensitive_filter; loads the stop
+    // words, the sensitive words and tag.txt into the vocab.
+    HotWordsEngine(const cppjieba::Jieba& jieba, const Config& cfg);
+    HotWordsEngine(const HotWordsEngine&) = delete;
+    HotWordsEngine& operator=(const HotWordsEngine&) = delete;
+
+    // Lines that are neither timestamped nor a command count at the current
+    // stream time instead of being rejected (console mode).
+    void SetUntimed(bool untimed) { opt_.untimed = untimed; }
+    // Replace the tag.txt list; empty allows every tag. Counts so far stay.
+    void SetAllowedTags(const std::vector<std::string>& tags);
+
+    // Read-only half of a line: classify, normalize, filter and segment.
+    void Parse(std::string& contents, ParsedLine& res, cppjieba::SegmentScratch& scratch) const {
+        parse_file_line(jieba_, contents, res, scratch, opt_);
+    }
+    // Apply a parsed line, in stream order: count a sentence, resize the
+    // window, or run a query (its result is top()).
+    void Commit(const ParsedLine& pl);
+
+    // Parse and commit one line; the result is valid until the next call.
+    const ParsedLine& IngestLine(std::string_view line) {
+        contents_.assign(line.data(), line.size());
+        Parse(contents_, parsed_, scratch_);
+        Commit(parsed_);
+        return parsed_;
+    }
+
+    // Parse and commit lines in order; on_line(const ParsedLine&, index) runs
+    // after each, e.g. to print a query's top().
+    template <class Fn>
+    void IngestBatch(const std::vector<std::string_view>& lines, Fn on_line) {
+        for (size_t i = 0; i < lines.size(); ++i) on_line(IngestLine(lines[i]), i);
+    }
+    void IngestBatch(const std::vector<std::string_view>& lines) {
+        IngestBatch(lines, [](const ParsedLine&, size_t) {});
+    }
+
+    // Every line of `reader`, parsed by `threads` pipeline workers and
+    // committed here in input order; on_line(const ParsedLine&, line index)
+    // runs after each. Returns the number of lines read.
+    template <class Fn>
+    size_t IngestStream(LineReader& reader, size_t threads, Fn on_line) {
+        LinePipeline pipeline(jieba_, threads);
+        pipeline.SetOptions(opt_);
+        return pipeline.Run(reader, [&](const LineBatch& batch) {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                Commit(batch.parsed[i]);
+                on_line(batch.parsed[i], batch.first_line + i);
+            }
+        });
+    }
+
+    // Top k at `minute`, as a QUERY line but with its own k.
+    const TopList& Query(long long minute, size_t k);
+    // Window size in minutes (clamped to 1..INT_MAX), as a WINDOW_SIZE line.
+    void SetWindowSize(long long minutes);
+
+    const TopList& top() const { return top_; }
+    size_t topk() const { return topk_; }
+    // "rank: word/tag/count" rows of top()
+    void WriteTop(std::ostream& out) const;
+    // What the file mode writes for a committed line (0-based `line`): the
+    // Query Time block, [INFO] for a window change, [WARNING] for a bad line.
+    void WriteLineResult(std::ostream& out, const ParsedLine& pl, size_t line) const;
+
+    const cppjieba::Jieba& jieba() const { return jieba_; }
+    HotWordCounter& counter() { return counter_; }
+    const HotWordCounter& counter() const { return counter_; }
+
+    // Sentences and queries committed, and the time they took; WINDOW_SIZE
+    // lines are only in the latency histograms.
+    long long processed_lines() const { return processed_lines_; }
+    long long processing_ns() const { return processing_ns_; }
+    const StageLatency& latency() const { return latency_; }
+
+    // "Program Metrics" block for the end of an output file: throughput of
+    // `lines` over `seconds`, mean processing time per line, memory and the
+    // stage latency table, which is also saved as <outputpath stem>_latency.json.
+    void WriteMetrics(std::ostream& out, long long lines, double seconds, const std::string& outputpath) const;
+
+ private:
+    void Finish(const StageTimes& times);
+
+    const cppjieba::Jieba& jieba_;
+    size_t topk_;
+    HotWordCounter counter_;
+    PhraseMatcher phrases_; // sensitive phrases for the mask / drop filters
+    ParseOptions opt_;
+    StageLatency latency_;
+    long long processed_lines_ = 0;
+    long long processing_ns_ = 0;
+
+    // reused from line to line
+    TopList top_;
+    std::vector<WordId> ids_;
+    std::string contents_;
+    ParsedLine parsed_;
+    cppjieba::SegmentScratch scratch_;
+};
@@ -0,0 +1,151 @@
+#pragma once
+// Append-only columnar token history.
+// Tokens are grouped into one block per minute of stream time; a block keeps
+// its word ids and their second-of-minute in two parallel arrays, so a token
+// costs 5 bytes and a time range scan is a sequential read over a few blocks.
+// Data arrives almost always in time order and lands at the end of the newest
+// block; a late event is appended to the block of its own minute, so ordering
+// inside a block is arrival order, never needed by any reader.
+//
+// Every block also has an aggregate, its (word id -> count) pairs sorted by
+// id. A minute's aggregate is built when the stream moves on to a later
+// minute, and late events are folded in on the next read, so a historical
+// query merges one small aggregate per minute instead of rescanning tokens.
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "vocab.hpp"
+
+class HistoryStore {
+ public:
+    struct MinuteBlock {
+        std::vector<WordId> ids;
+        std::vector<uint8_t> secs; // second within the minute, 0..59
+    };
+    struct MinuteCounts {
+        std::vector<WordId> ids;      // sorted, distinct
+        std::vector<uint32_t> counts; // counts[i] belongs to ids[i]
+        size_t covered = 0;           // leading tokens of the block folded in
+    };
+
+    void Append(long long time, WordId id) {
+        size_t minute = static_cast<size_t>(time / 60);
+        if (minute >= blocks_.size()) {
+            // the newest minute is complete (up to late events): aggregate it now
+            if (!blocks_.empty()) Aggregate(blocks_.size() - 1);
+            blocks_.resize(minute + 1);
+            aggs_.resize(minute + 1);
+        }
+        blocks_[minute].ids.push_back(id);
+        blocks_[minute].secs.push_back(static_cast<uint8_t>(time % 60));
+        ++size_;
+    }
+
+    // Call f(id) for every token with from <= time < to (seconds).
+    template <class Fn>
+    void ForEach(long long from, long long to, Fn f) const {
+        if (from < 0) from = 0;
+        if (to <= from) return;
+        size_t first = static_cast<size_t>(from / 60);
+        size_t last = static_cast<size_t>((to - 1) / 60);
+        if (last >= blocks_.size()) {
+            if (blocks_.empty()) return;
+            last = blocks_.size() - 1;
+            to = static_cast<long long>(blocks_.size()) * 60;
+        }
+        for (size_t m = first; m <= last && m < blocks_.size(); ++m) {
+            const MinuteBlock& b = blocks_[m];
+            long long base = static_cast<long long>(m) * 60;
+            if (base >= from && base + 60 <= to) {
+                for (WordId id : b.ids) f(id); // whole minute inside the range
+                continue;
+            }
+            for (size_t i = 0; i < b.ids.size(); ++i) {
+                long long t = base + b.secs[i];
+                if (t >= from && t < to) f(b.ids[i]);
+            }
+        }
+    }
+
+    // Call f(id, count) with the number of tokens of every word with
+    // from <= time < to (seconds): aggregates for whole minutes, a token scan
+    // for the partial minutes at both ends. A word may be reported more than
+    // once, split over minutes.
+    template <class Fn>
+    void ForEachCountIn(long long from, long long to, Fn f) const {
+        if (from < 0) from = 0;
+        if (to <= from) return;
+        long long first_full = (from + 59) / 60;   // first minute starting at or after from
+        long long end_full = to / 60;              // minutes before this end by to
+        if (first_full >= end_full) {
+            ForEach(from, to, [&](WordId id) { f(id, 1u); });
+            return;
+        }
+        ForEach(from, first_full * 60, [&](WordId id) { f(id, 1u); });
+        ForEachCount(static_cast<size_t>(first_full), static_cast<size_t>(end_full - 1), f);
+        ForEach(end_full * 60, to, [&](WordId id) { f(id, 1u); });
+    }
+
+    // Call f(id, count) for every word of the minutes [first, last].
+    template <class Fn>
+    void ForEachCount(size_t first, size_t last, Fn f) const {
+        for (size_t m = first; m <= last && m < blocks_.size(); ++m) {
+            const MinuteCounts& agg = Aggregate(m);
+            for (size_t i = 0; i < agg.ids.size(); ++i) f(agg.ids[i], agg.counts[i]);
+        }
+    }
+
+    // Bring the aggregate of `minute` up to date with its block and return it.
+    const MinuteCounts& Aggregate(size_t minute) const {
+        const MinuteBlock& b = blocks_[minute];
+        MinuteCounts& agg = aggs_[minute];
+        if (agg.covered == b.ids.size()) return agg;
+        // run-length the unaggregated tail, then merge it into the sorted pairs
+        tail_.assign(b.ids.begin() + agg.covered, b.ids.end());
+        std::sort(tail_.begin(), tail_.end());
+        merged_ids_.clear();
+        merged_counts_.clear();
+        size_t i = 0, j = 0;
+        while (i < agg.ids.size() || j < tail_.size()) {
+            if (j == tail_.size() || (i < agg.ids.size() && agg.ids[i] < tail_[j])) {
+                merged_ids_.push_back(agg.ids[i]);
+                merged_counts_.push_back(agg.counts[i]);
+                ++i;
+                continue;
+            }
+            WordId id = tail_[j];
+            uint32_t n = 0;
+            while (j < tail_.size() && tail_[j] == id) ++n, ++j;
+            if (i < agg.ids.size() && agg.ids[i] == id) n += agg.counts[i++];
+            merged_ids_.push_back(id);
+            merged_counts_.push_back(n);
+        }
+        agg.ids.assign(merged_ids_.begin(), merged_ids_.end());
+        agg.counts.assign(merged_counts_.begin(), merged_counts_.end());
+        agg.covered = b.ids.size();
+        return agg;
+    }
+
+    size_t size() const { return size_; }
+
+    // Estimated heap bytes of the token blocks, the minute aggregates and the
+    // aggregation scratch.
+    size_t MemoryBytes() const {
+        size_t bytes = blocks_.capacity() * sizeof(MinuteBlock) + aggs_.capacity() * sizeof(MinuteCounts);
+        for (const MinuteBlock& b : blocks_) bytes += b.ids.capacity() * sizeof(WordId) + b.secs.capacity();
+        for (const MinuteCounts& a : aggs_) bytes += a.ids.capacity() * sizeof(WordId) + a.counts.capacity() * sizeof(uint32_t);
+        bytes += (tail_.capacity() + merged_ids_.capacity()) * sizeof(WordId) + merged_counts_.capacity() * sizeof(uint32_t);
+        return bytes;
+    }
+    size_t minutes() const { return blocks_.size(); }
+    const MinuteBlock& block(size_t minute) const { return blocks_[minute]; }
+
+ private:
+    std::vector<MinuteBlock> blocks_; // indexed by minute of stream time
+    mutable std::vector<MinuteCounts> aggs_; // aggs_[m] summarizes blocks_[m]
+    size_t size_ = 0;
+    // Aggregate() working storage
+    mutable std::vector<WordId> tail_;
+    mutable std::vector<WordId> merged_ids_;
+    mutable std::vector<uint32_t> merged_counts_;
+};
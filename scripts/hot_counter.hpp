@@ -0,0 +1,121 @@
+#pragma once
+// Sliding-window hot word counter shared by file and console mode.
+// All structures run on vocab ids; strings are only touched when ranking ties
+// and when the caller prints the result.
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "vocab.hpp"
+#include "history_store.hpp"
+#include "stream_summary.hpp"
+
+class HotWordCounter {
+ public:
+    explicit HotWordCounter(int time_range) : time_range_(time_range) {}
+
+    Vocab& vocab() { return vocab_; }
+    const Vocab& vocab() const { return vocab_; }
+    long long current_time() const { return currtime_; }
+    int time_range() const { return time_range_; }
+    const StreamSummary& window() const { return window_; }
+    const HistoryStore& history() const { return history_; }
+
+    // Move the stream clock forward; late events do not move it back.
+    void Observe(long long time) {
+        if (time >= currtime_) currtime_ = time;
+    }
+
+    // Count one token at `time` (seconds) in the history, and in the window
+    // unless it is older than everything evicted so far.
+    void Add(long long time, WordId id) {
+        history_.Append(time, id);
+        if (time >= evicted_upto_) Increment(id);
+    }
+
+    // Drop window entries that fell out of [currtime - time_range, ...]: the
+    // window holds exactly the tokens with time >= evicted_upto_, so only the
+    // history between the old and the new threshold has to be read.
+    void Evict() {
+        long long threshold = Threshold();
+        if (threshold <= evicted_upto_) return;
+        history_.ForEachCountIn(evicted_upto_, threshold, [this](WordId id, uint32_t n) {
+            window_.Sub(id, static_cast<int>(n));
+        });
+        evicted_upto_ = threshold;
+    }
+
+    // Change the window size (minutes). Only the history between the old and
+    // the new threshold is read: a larger window adds the older span, a
+    // smaller one subtracts the dropped span, both mostly from minute aggregates.
+    void SetTimeRange(int minutes) {
+        time_range_ = minutes;
+        long long threshold = Threshold();
+        if (threshold < evicted_upto_) {
+            history_.ForEachCountIn(threshold, evicted_upto_, [this](WordId id, uint32_t n) {
+                window_.Add(id, static_cast<int>(n));
+            });
+            evicted_upto_ = threshold;
+        } else {
+            Evict();
+        }
+    }
+
+    // Top k (word id, count) at minute `query_minute`, highest count first and
+    // the lexicographically smaller word first on ties. The current minute is
+    // answered from the live window, any other minute from history over
+    // [query - time_range, query] minutes.
+    void TopK(long long query_minute, size_t k, std::vector<std::pair<WordId, int>>& res) const {
+        auto word_less = [this](WordId a, WordId b) { return vocab_.Word(a) < vocab_.Word(b); };
+        // saturate instead of overflowing: such a minute is past all history anyway
+        long long qtime_seconds = query_minute > std::numeric_limits<long long>::max() / 60
+                                      ? std::numeric_limits<long long>::max() : query_minute * 60;
+        bool is_current_window = (currtime_ >= qtime_seconds) && (currtime_ - qtime_seconds < 60);
+        if (is_current_window) {
+            window_.TopK(k, word_less, res); // kept up to date on every +1/-1
+        } else {
+            // [start, query] is minute aligned: merge the per-minute aggregates
+            long long start_time = (qtime_seconds >= WindowSeconds()) ? (qtime_seconds - WindowSeconds()) : 0;
+            if (query_minute >= 0) {
+                history_.ForEachCount(static_cast<size_t>(start_time / 60), static_cast<size_t>(query_minute),
+                                      [this](WordId id, uint32_t n) {
+                    if (id >= query_count_.size()) query_count_.resize(id + 1, 0);
+                    if (query_count_[id] == 0) query_touched_.push_back(id);
+                    query_count_[id] += static_cast<int>(n);
+                });
+            }
+            res.clear();
+            for (WordId id : query_touched_) {
+                res.emplace_back(id, query_count_[id]);
+                query_count_[id] = 0;
+            }
+            query_touched_.clear();
+            auto rank = [&](const std::pair<WordId, int>& a, const std::pair<WordId, int>& b) {
+                if (a.second != b.second) return a.second > b.second;
+                return word_less(a.first, b.first);
+            };
+            size_t n = std::min(k, res.size());
+            std::partial_sort(res.begin(), res.begin() + n, res.end(), rank);
+            res.resize(n);
+        }
+    }
+
+ private:
+    long long Threshold() const {
+        return (currtime_ >= WindowSeconds()) ? (currtime_ - WindowSeconds()) : 0;
+    }
+    long long WindowSeconds() const { return static_cast<long long>(time_range_) * 60; }
+
+    void Increment(WordId id) { window_.Increment(id); }
+
+    Vocab vocab_;
+    long long currtime_ = 0;  // stream time (s)
+    int time_range_;          // window size (min)
+
+    StreamSummary window_;              // live window counts, ranked
+    long long evicted_upto_ = 0;        // window = tokens with time >= this
+    HistoryStore history_;              // every token, any minute can be queried
+    // historical TopK working storage, all zero between queries
+    mutable std::vector<int> query_count_;
+    mutable std::vector<WordId> query_touched_;
+};
@@ -0,0 +1,209 @@
+#pragma once
+// Per-stage latency histograms in nanoseconds.
+// A LatencyHistogram is log-linear like an HDR histogram: values below 64 ns
+// have a bucket each, and every power of two above is split into 64 equal
+// buckets, so any recorded value is known to within 1/64 (1.6%) however long
+// the tail is. A percentile is the upper edge of the bucket it falls in,
+// capped by the largest value recorded. Recording is an index computation
+// and an increment; there is no allocation after construction.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class LatencyHistogram {
+ public:
+    LatencyHistogram() : counts_(kBuckets, 0) {}
+
+    void Record(uint64_t ns) {
+        ++counts_[Index(ns)];
+        ++count_;
+        sum_ += ns;
+        if (ns > max_) max_ = ns;
+    }
+
+    void Merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBuckets; ++i) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t Count() const { return count_; }
+    uint64_t Sum() const { return sum_; }
+    uint64_t Max() const { return max_; }
+    double Mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+    // Smallest recorded value v (to histogram precision) such that p percent
+    // of the values are <= v; 0 if nothing was recorded.
+    uint64_t Percentile(double p) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * count_));
+        rank = std::min(std::max<uint64_t>(rank, 1), count_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(UpperEdge(i), max_);
+        }
+        return max_;
+    }
+
+ private:
+    static constexpr int kSubBits = 6;
+    static constexpr uint64_t kSub = uint64_t(1) << kSubBits; // buckets per power of two
+    static constexpr int kMaxBits = 48;                       // ~78 hours; longer is clamped
+    static constexpr size_t kBuckets = kSub + (kMaxBits - kSubBits) * kSub;
+
+    static int HighBit(uint64_t v) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(v);
+#else
+        int h = 0;
+        while (v >>= 1) ++h;
+        return h;
+#endif
+    }
+
+    static size_t Index(uint64_t v) {
+        if (v < kSub) return static_cast<size_t>(v);
+        int h = HighBit(v);
+        if (h >= kMaxBits) return kBuckets - 1;
+        int shift = h - kSubBits;
+        return static_cast<size_t>(kSub + shift * kSub + ((v >> shift) - kSub));
+    }
+
+    static uint64_t UpperEdge(size_t i) {
+        if (i < kSub) return i;
+        size_t shift = (i - kSub) / kSub;
+        uint64_t top = kSub + (i - kSub) % kSub;
+        return ((top + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Stages of the per-line work. Parsing, normalization, the sensitive phrase
+// filter and segmentation run in the pipeline workers; the vocab filter,
+// counting, eviction and queries run in the committing thread.
+enum Stage {
+    kStageParse,      // timestamp / command recognition
+    kStageNormalize,  // NFC and text folding
+    kStageSegment,    // jieba tagging
+    kStageFilter,     // sensitive phrases, stop words and tags
+    kStageCount,      // history and window updates
+    kStageEvict,      // window eviction and resizing
+    kStageQuery,      // Top-K
+    kStageNum,
+};
+
+inline const char* stage_name(int stage) {
+    static const char* const kNames[kStageNum] = {
+        "parse", "normalize", "segment", "filter", "count", "evict", "query",
+    };
+    return kNames[stage];
+}
+
+// The time one line spent in each stage; a stage that did not run for the
+// line is not recorded.
+struct StageTimes {
+    long long ns[kStageNum] = {};
+    uint32_t ran = 0; // bit per stage
+
+    void Clear() {
+        std::fill(ns, ns + kStageNum, 0);
+        ran = 0;
+    }
+    void Add(Stage stage, long long v) {
+        ns[stage] += v;
+        ran |= 1u << stage;
+    }
+    long long Total() const {
+        long long sum = 0;
+        for (int s = 0; s < kStageNum; ++s) sum += ns[s];
+        return sum;
+    }
+};
+
+// Splits a stretch of work into consecutive stages: Lap() returns the time
+// since construction or the previous Lap().
+class StageTimer {
+ public:
+    using Clock = std::chrono::steady_clock;
+
+    StageTimer() : last_(Clock::now()) {}
+
+    long long Lap() {
+        Clock::time_point now = Clock::now();
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count();
+        last_ = now;
+        return ns;
+    }
+
+    void Lap(StageTimes& times, Stage stage) { times.Add(stage, Lap()); }
+
+ private:
+    Clock::time_point last_;
+};
+
+// One histogram per stage plus one of whole lines (the sum of their stages).
+class StageLatency {
+ public:
+    void Record(const StageTimes& times) {
+        for (int s = 0; s < kStageNum; ++s) {
+            if (times.ran & (1u << s)) stages_[s].Record(static_cast<uint64_t>(std::max(0LL, times.ns[s])));
+        }
+        line_.Record(static_cast<uint64_t>(std::max(0LL, times.Total())));
+    }
+
+    const LatencyHistogram& stage(int s) const { return stages_[s]; }
+    const LatencyHistogram& line() const { return line_; }
+
+    // Table for the end of the output file.
+    void WriteReport(std::ostream& out) const {
+        out << "StageLatency(ns): count p50 p90 p99 p99.9 max\n";
+        for (int s = 0; s < kStageNum; ++s) WriteRow(out, stage_name(s), stages_[s]);
+        WriteRow(out, "line", line_);
+    }
+
+    // Same figures plus mean and sum, as JSON.
+    bool WriteJson(const std::string& path) const {
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open()) return false;
+        out << "{\n  \"unit\": \"ns\",\n  \"stages\": [\n";
+        for (int s = 0; s < kStageNum; ++s) {
+            WriteJsonRow(out, stage_name(s), stages_[s]);
+            out << ",\n";
+        }
+        WriteJsonRow(out, "line", line_);
+        out << "\n  ]\n}\n";
+        return true;
+    }
+
+ private:
+    static void WriteRow(std::ostream& out, const char* name, const LatencyHistogram& h) {
+        out << "  " << std::left << std::setw(10) << name << std::right
+            << std::setw(10) << h.Count()
+            << std::setw(10) << h.Percentile(50) << std::setw(10) << h.Percentile(90)
+            << std::setw(10) << h.Percentile(99) << std::setw(10) << h.Percentile(99.9)
+            << std::setw(12) << h.Max() << "\n";
+    }
+
+    static void WriteJsonRow(std::ostream& out, const char* name, const LatencyHistogram& h) {
+        out << "    {\"name\": \"" << name << "\", \"count\": " << h.Count() << ", \"sum\": " << h.Sum()
+            << ", \"mean\": " << std::fixed << std::setprecision(1) << h.Mean()
+            << ", \"p50\": " << h.Percentile(50) << ", \"p90\": " << h.Percentile(90)
+            << ", \"p99\": " << h.Percentile(99) << ", \"p99_9\": " << h.Percentile(99.9)
+            << ", \"max\": " << h.Max() << "}";
+    }
+
+    LatencyHistogram stages_[kStageNum];
+    LatencyHistogram line_;
+};
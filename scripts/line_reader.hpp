@@ -0,0 +1,181 @@
+#pragma once
+// Streaming line reader for file mode.
+// Lines are handed out as std::string_view into either a read-only memory
+// mapping of the input (POSIX) or a fixed-size read buffer (Windows, pipes,
+// or when mmap fails), so no line is ever copied onto the heap by the reader
+// and memory use stays flat regardless of the input size.
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class LineReader {
+ public:
+    // 4 MB is large enough to amortize read() calls and small enough to stay in L2/L3
+    static const size_t kDefaultBufferSize = 4u << 20;
+    // pages behind the cursor are dropped from the mapping every this many bytes
+    static const size_t kReleaseStride = 64u << 20;
+
+    explicit LineReader(size_t buffer_size = kDefaultBufferSize)
+        : buffer_size_(buffer_size) {
+    }
+    ~LineReader() {
+        Close();
+    }
+    LineReader(const LineReader&) = delete;
+    LineReader& operator=(const LineReader&) = delete;
+
+    bool Open(const std::string& path) {
+        Close();
+#ifndef _WIN32
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        struct stat st;
+        if (::fstat(fd_, &st) == 0 && S_ISREG(st.st_mode)) {
+            map_size_ = static_cast<size_t>(st.st_size);
+            if (map_size_ == 0) { // empty file: Next() returns false at once
+                eof_ = true;
+                return true;
+            }
+            void* p = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (p != MAP_FAILED) {
+                map_ = static_cast<const char*>(p);
+                ::madvise(p, map_size_, MADV_SEQUENTIAL);
+                return true;
+            }
+            map_size_ = 0;
+        }
+        // not a regular file or mmap refused: fall back to buffered reads on the same fd
+#else
+        file_ = std::fopen(path.c_str(), "rb");
+        if (file_ == nullptr) return false;
+#endif
+        buffer_.resize(buffer_size_);
+        return true;
+    }
+
+    void Close() {
+#ifndef _WIN32
+        if (map_ != nullptr) ::munmap(const_cast<char*>(map_), map_size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#else
+        if (file_ != nullptr) std::fclose(file_);
+        file_ = nullptr;
+#endif
+        map_ = nullptr;
+        map_size_ = 0;
+        map_pos_ = 0;
+        released_ = 0;
+        buf_begin_ = buf_end_ = 0;
+        eof_ = false;
+        std::vector<char>().swap(buffer_);
+    }
+
+    // Fetch the next non-empty line with the trailing '\r' removed (same rules as
+    // ReadUtf8Lines). The view stays valid until the next call to Next().
+    bool Next(std::string_view& line) {
+        while (true) {
+            bool got = (map_ != nullptr) ? NextMapped(line) : NextBuffered(line);
+            if (!got) return false;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (!line.empty()) return true;
+        }
+    }
+
+ private:
+    bool NextMapped(std::string_view& line) {
+        if (map_pos_ >= map_size_) return false;
+        const char* begin = map_ + map_pos_;
+        size_t left = map_size_ - map_pos_;
+        const char* nl = static_cast<const char*>(std::memchr(begin, '\n', left));
+        size_t len = nl ? static_cast<size_t>(nl - begin) : left;
+        line = std::string_view(begin, len);
+        map_pos_ += nl ? len + 1 : len;
+        ReleaseConsumed();
+        return true;
+    }
+
+    // Give consumed pages back to the kernel so RSS does not grow with the file.
+    // The page containing the current line is kept.
+    void ReleaseConsumed() {
+#ifndef _WIN32
+        if (map_pos_ - released_ < kReleaseStride) return;
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t upto = ((map_pos_ - kReleaseStride / 2) / page) * page;
+        if (upto <= released_) return;
+        ::madvise(const_cast<char*>(map_) + released_, upto - released_, MADV_DONTNEED);
+        released_ = upto;
+#endif
+    }
+
+    bool NextBuffered(std::string_view& line) {
+        while (true) {
+            const char* begin = buffer_.data() + buf_begin_;
+            size_t avail = buf_end_ - buf_begin_;
+            const char* nl = avail ? static_cast<const char*>(std::memchr(begin, '\n', avail)) : nullptr;
+            if (nl != nullptr) {
+                size_t len = static_cast<size_t>(nl - begin);
+                line = std::string_view(begin, len);
+                buf_begin_ += len + 1;
+                return true;
+            }
+            if (eof_) {
+                if (avail == 0) return false;
+                line = std::string_view(begin, avail); // last line without '\n'
+                buf_begin_ = buf_end_;
+                return true;
+            }
+            // move the partial line to the front and refill behind it
+            if (buf_begin_ > 0) {
+                std::memmove(buffer_.data(), begin, avail);
+                buf_begin_ = 0;
+                buf_end_ = avail;
+            }
+            if (buf_end_ == buffer_.size()) {
+                buffer_.resize(buffer_.size() * 2); // a single line longer than the buffer
+            }
+            size_t n = Read(buffer_.data() + buf_end_, buffer_.size() - buf_end_);
+            if (n == 0) eof_ = true;
+            buf_end_ += n;
+        }
+    }
+
+    size_t Read(char* dst, size_t cap) {
+#ifndef _WIN32
+        ssize_t n;
+        do {
+            n = ::read(fd_, dst, cap);
+        } while (n < 0 && errno == EINTR);
+        return n > 0 ? static_cast<size_t>(n) : 0;
+#else
+        return std::fread(dst, 1, cap, file_);
+#endif
+    }
+
+    size_t buffer_size_;
+#ifndef _WIN32
+    int fd_ = -1;
+#else
+    FILE* file_ = nullptr;
+#endif
+    // mmap backend
+    const char* map_ = nullptr;
+    size_t map_size_ = 0;
+    size_t map_pos_ = 0;
+    size_t released_ = 0;
+    // buffered backend
+    std::vector<char> buffer_;
+    size_t buf_begin_ = 0;
+    size_t buf_end_ = 0;
+    bool eof_ = false;
+};
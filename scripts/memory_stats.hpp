@@ -0,0 +1,69 @@
+#pragma once
+// Process memory and an estimate of what the large structures hold, for the
+// metrics at the end of the output file. Resident and peak resident set come
+// from /proc/self/status on Linux and from the working set on Windows; the
+// per-structure figures are MemoryBytes() estimates (container capacities,
+// hash nodes and heap strings), so their sum is below the RSS, which also
+// counts the allocator, the code and the I/O buffers.
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include "Jieba.hpp"
+#include "hot_counter.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+struct ProcessMemory {
+    double rss_mb = 0.0;  // resident now (VmRSS)
+    double peak_mb = 0.0; // highest resident so far (VmHWM)
+};
+
+inline ProcessMemory get_process_memory() {
+    ProcessMemory mem;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        mem.rss_mb = static_cast<double>(pmc.WorkingSetSize) / (1024.0 * 1024.0);
+        mem.peak_mb = static_cast<double>(pmc.PeakWorkingSetSize) / (1024.0 * 1024.0);
+    }
+#elif defined(__linux__)
+    FILE* fp = std::fopen("/proc/self/status", "r");
+    if (fp == nullptr) return mem;
+    char line[256];
+    while (std::fgets(line, sizeof(line), fp)) {
+        unsigned long long kb = 0;
+        if (std::strncmp(line, "VmRSS:", 6) == 0 && std::sscanf(line + 6, "%llu", &kb) == 1) {
+            mem.rss_mb = kb / 1024.0;
+        } else if (std::strncmp(line, "VmHWM:", 6) == 0 && std::sscanf(line + 6, "%llu", &kb) == 1) {
+            mem.peak_mb = kb / 1024.0;
+        }
+    }
+    std::fclose(fp);
+#endif
+    return mem;
+}
+
+// Memory(MB) / PeakMemory(MB) and the estimated size of each structure.
+inline void write_memory_report(std::ostream& out, const cppjieba::Jieba& jieba, const HotWordCounter& counter) {
+    ProcessMemory mem = get_process_memory();
+    out << "Memory(MB): " << mem.rss_mb << "\n";
+    out << "PeakMemory(MB): " << mem.peak_mb << "\n";
+    struct Row { const char* name; size_t bytes; };
+    const Row rows[] = {
+        {"dict_trie", jieba.GetDictTrie()->MemoryBytes()},
+        {"hmm_model", jieba.GetHMMModel()->MemoryBytes()},
+        {"vocab", counter.vocab().MemoryBytes()},     // words, tags and filter flags by id
+        {"window", counter.window().MemoryBytes()},   // live window counts and ranking
+        {"history", counter.history().MemoryBytes()}, // every token by minute, minute aggregates
+    };
+    out << "MemoryBreakdown(MB, estimated):\n";
+    for (const Row& r : rows) {
+        out << "  " << std::left << std::setw(10) << r.name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(3) << r.bytes / (1024.0 * 1024.0) << "\n";
+    }
+    out.unsetf(std::ios::fixed);
+    out << std::setprecision(6);
+}
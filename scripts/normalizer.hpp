@@ -0,0 +1,116 @@
+#pragma once
+// Single-pass text normalizer working in place on UTF-8 bytes.
+// Folds spelling variants that would otherwise become separate vocabulary
+// entries:
+//   - Kangxi radicals U+2F00..U+2FD5 -> their NFKC unified ideograph (⼈ -> 人)
+//   - full-width digits and Latin letters U+FF10..U+FF5A -> ASCII (Ａ -> a)
+//   - ASCII A-Z -> a-z
+// Every replacement is no longer than what it replaces, so the string only
+// shrinks and is rewritten in place; a line without any candidate lead byte
+// (A-Z, 0xE2, 0xEF) is only scanned, never written. Invalid UTF-8 is copied
+// through unchanged.
+#include <cstdint>
+#include <string>
+
+namespace normalize_detail {
+
+// byte -> what a byte starting a sequence can turn into
+enum : uint8_t { kKeep = 0, kUpper = 1, kLeadE2 = 2, kLeadEF = 3 };
+
+struct ByteTable {
+    uint8_t cls[256];
+};
+
+constexpr ByteTable MakeByteTable() {
+    ByteTable t{};
+    for (int c = 'A'; c <= 'Z'; ++c) t.cls[c] = kUpper;
+    t.cls[0xE2] = kLeadE2;
+    t.cls[0xEF] = kLeadEF;
+    return t;
+}
+
+constexpr ByteTable kBytes = MakeByteTable();
+
+// NFKC of U+2F00 + i
+constexpr uint16_t kKangxiUnified[0x2FD6 - 0x2F00] = {
+    0x4E00, 0x4E28, 0x4E36, 0x4E3F, 0x4E59, 0x4E85, 0x4E8C, 0x4EA0,
+    0x4EBA, 0x513F, 0x5165, 0x516B, 0x5182, 0x5196, 0x51AB, 0x51E0,
+    0x51F5, 0x5200, 0x529B, 0x52F9, 0x5315, 0x531A, 0x5338, 0x5341,
+    0x535C, 0x5369, 0x5382, 0x53B6, 0x53C8, 0x53E3, 0x56D7, 0x571F,
+    0x58EB, 0x5902, 0x590A, 0x5915, 0x5927, 0x5973, 0x5B50, 0x5B80,
+    0x5BF8, 0x5C0F, 0x5C22, 0x5C38, 0x5C6E, 0x5C71, 0x5DDB, 0x5DE5,
+    0x5DF1, 0x5DFE, 0x5E72, 0x5E7A, 0x5E7F, 0x5EF4, 0x5EFE, 0x5F0B,
+    0x5F13, 0x5F50, 0x5F61, 0x5F73, 0x5FC3, 0x6208, 0x6236, 0x624B,
+    0x652F, 0x6534, 0x6587, 0x6597, 0x65A4, 0x65B9, 0x65E0, 0x65E5,
+    0x66F0, 0x6708, 0x6728, 0x6B20, 0x6B62, 0x6B79, 0x6BB3, 0x6BCB,
+    0x6BD4, 0x6BDB, 0x6C0F, 0x6C14, 0x6C34, 0x706B, 0x722A, 0x7236,
+    0x723B, 0x723F, 0x7247, 0x7259, 0x725B, 0x72AC, 0x7384, 0x7389,
+    0x74DC, 0x74E6, 0x7518, 0x751F, 0x7528, 0x7530, 0x758B, 0x7592,
+    0x7676, 0x767D, 0x76AE, 0x76BF, 0x76EE, 0x77DB, 0x77E2, 0x77F3,
+    0x793A, 0x79B8, 0x79BE, 0x7A74, 0x7ACB, 0x7AF9, 0x7C73, 0x7CF8,
+    0x7F36, 0x7F51, 0x7F8A, 0x7FBD, 0x8001, 0x800C, 0x8012, 0x8033,
+    0x807F, 0x8089, 0x81E3, 0x81EA, 0x81F3, 0x81FC, 0x820C, 0x821B,
+    0x821F, 0x826E, 0x8272, 0x8278, 0x864D, 0x866B, 0x8840, 0x884C,
+    0x8863, 0x897E, 0x898B, 0x89D2, 0x8A00, 0x8C37, 0x8C46, 0x8C55,
+    0x8C78, 0x8C9D, 0x8D64, 0x8D70, 0x8DB3, 0x8EAB, 0x8ECA, 0x8F9B,
+    0x8FB0, 0x8FB5, 0x9091, 0x9149, 0x91C6, 0x91CC, 0x91D1, 0x9577,
+    0x9580, 0x961C, 0x96B6, 0x96B9, 0x96E8, 0x9751, 0x975E, 0x9762,
+    0x9769, 0x97CB, 0x97ED, 0x97F3, 0x9801, 0x98A8, 0x98DB, 0x98DF,
+    0x9996, 0x9999, 0x99AC, 0x9AA8, 0x9AD8, 0x9ADF, 0x9B25, 0x9B2F,
+    0x9B32, 0x9B3C, 0x9B5A, 0x9CE5, 0x9E75, 0x9E7F, 0x9EA5, 0x9EBB,
+    0x9EC3, 0x9ECD, 0x9ED1, 0x9EF9, 0x9EFD, 0x9F0E, 0x9F13, 0x9F20,
+    0x9F3B, 0x9F4A, 0x9F52, 0x9F8D, 0x9F9C, 0x9FA0,
+};
+
+inline bool IsCont(uint8_t c) { return (c & 0xC0) == 0x80; }
+
+} // namespace normalize_detail
+
+// Normalize s in place, see above. Returns true if s changed.
+inline bool normalize_text(std::string& s) {
+    using namespace normalize_detail;
+    const size_t n = s.size();
+    size_t r = 0;
+    while (r < n && kBytes.cls[static_cast<uint8_t>(s[r])] == kKeep) ++r;
+    if (r == n) return false;
+
+    char* p = &s[0];
+    size_t w = r;
+    bool changed = false;
+    while (r < n) {
+        uint8_t c = static_cast<uint8_t>(p[r]);
+        uint8_t cls = kBytes.cls[c];
+        if (cls == kUpper) {
+            p[w++] = static_cast<char>(c + ('a' - 'A'));
+            ++r;
+            changed = true;
+            continue;
+        }
+        if (cls != kKeep && n - r >= 3 && IsCont(static_cast<uint8_t>(p[r + 1])) && IsCont(static_cast<uint8_t>(p[r + 2]))) {
+            uint32_t cp = ((c & 0x0Fu) << 12) | ((static_cast<uint8_t>(p[r + 1]) & 0x3Fu) << 6) |
+                          (static_cast<uint8_t>(p[r + 2]) & 0x3Fu);
+            if (cls == kLeadE2 && cp >= 0x2F00 && cp <= 0x2FD5) {
+                uint32_t u = kKangxiUnified[cp - 0x2F00]; // always 3 bytes in UTF-8
+                p[w++] = static_cast<char>(0xE0 | (u >> 12));
+                p[w++] = static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+                p[w++] = static_cast<char>(0x80 | (u & 0x3F));
+                r += 3;
+                changed = true;
+                continue;
+            }
+            if (cls == kLeadEF && cp >= 0xFF10 && cp <= 0xFF5A) {
+                uint32_t a = cp - 0xFEE0; // full-width -> ASCII
+                if (a >= 'A' && a <= 'Z') a += 'a' - 'A';
+                if ((a >= '0' && a <= '9') || (a >= 'a' && a <= 'z')) {
+                    p[w++] = static_cast<char>(a);
+                    r += 3;
+                    changed = true;
+                    continue;
+                }
+            }
+        }
+        p[w++] = p[r++];
+    }
+    s.resize(w);
+    return changed;
+}
@@ -0,0 +1,150 @@
+#pragma once
+// Aho-Corasick automaton over UTF-8 bytes, for the sensitive phrase list.
+// One left-to-right pass over a line finds the phrases occurring in it in
+// O(line length + matches), however many phrases there are, and independent
+// of how the segmenter would later split the line. Phrases are whole UTF-8
+// strings and UTF-8 is self-synchronizing, so a match always starts and ends
+// on character boundaries.
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class PhraseMatcher {
+ public:
+    // Replace the phrase list; empty phrases are ignored.
+    void Build(const std::vector<std::string>& phrases) {
+        // plain trie first: children as (byte, state) lists
+        std::vector<std::vector<std::pair<uint8_t, uint32_t>>> children(1);
+        std::vector<uint32_t> own_len(1, 0);
+        phrase_count_ = 0;
+        for (const std::string& p : phrases) {
+            if (p.empty()) continue;
+            uint32_t s = 0;
+            for (unsigned char c : p) {
+                uint32_t next = kNone;
+                for (const auto& e : children[s]) {
+                    if (e.first == c) { next = e.second; break; }
+                }
+                if (next == kNone) {
+                    next = static_cast<uint32_t>(children.size());
+                    children[s].emplace_back(c, next);
+                    children.emplace_back();
+                    own_len.push_back(0);
+                }
+                s = next;
+            }
+            own_len[s] = static_cast<uint32_t>(p.size());
+            ++phrase_count_;
+        }
+
+        // flatten into sorted edge arrays
+        const size_t n = children.size();
+        edge_begin_.assign(n + 1, 0);
+        edge_bytes_.clear();
+        edge_targets_.clear();
+        for (size_t s = 0; s < n; ++s) {
+            std::sort(children[s].begin(), children[s].end());
+            edge_begin_[s] = static_cast<uint32_t>(edge_bytes_.size());
+            for (const auto& e : children[s]) {
+                edge_bytes_.push_back(e.first);
+                edge_targets_.push_back(e.second);
+            }
+        }
+        edge_begin_[n] = static_cast<uint32_t>(edge_bytes_.size());
+        for (int c = 0; c < 256; ++c) root_[c] = 0;
+        for (const auto& e : children[0]) root_[e.first] = e.second;
+
+        // failure links breadth first; out_len_ is the longest phrase ending
+        // at a state, its own or one reached through the failure chain
+        fail_.assign(n, 0);
+        out_len_ = own_len;
+        std::vector<uint32_t> queue;
+        queue.reserve(n);
+        for (const auto& e : children[0]) queue.push_back(e.second);
+        for (size_t head = 0; head < queue.size(); ++head) {
+            uint32_t s = queue[head];
+            out_len_[s] = std::max(out_len_[s], out_len_[fail_[s]]);
+            for (const auto& e : children[s]) {
+                fail_[e.second] = Next(fail_[s], e.first);
+                queue.push_back(e.second);
+            }
+        }
+    }
+
+    bool Empty() const { return phrase_count_ == 0; }
+    size_t Size() const { return phrase_count_; }
+
+    // Call f(begin, end) (byte offsets) for the longest phrase ending at each
+    // position where one ends; shorter phrases ending there lie inside it.
+    template <class Fn>
+    void ForEachMatch(std::string_view text, Fn f) const {
+        if (Empty()) return;
+        uint32_t s = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            s = Next(s, static_cast<unsigned char>(text[i]));
+            if (out_len_[s]) f(i + 1 - out_len_[s], i + 1);
+        }
+    }
+
+    bool Contains(std::string_view text) const {
+        if (Empty()) return false;
+        uint32_t s = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            s = Next(s, static_cast<unsigned char>(text[i]));
+            if (out_len_[s]) return true;
+        }
+        return false;
+    }
+
+    // Overwrite every byte covered by a match with `fill`, in place. Returns
+    // the number of matches. A later match may begin before an earlier one
+    // (its phrase contains the other), so overlapping matches are merged
+    // first and every byte is written at most once.
+    size_t Mask(std::string& text, char fill) const {
+        std::vector<std::pair<size_t, size_t>> spans; // merged, in text order
+        size_t matches = 0;
+        ForEachMatch(text, [&](size_t begin, size_t end) {
+            ++matches;
+            while (!spans.empty() && spans.back().second >= begin) {
+                begin = std::min(begin, spans.back().first);
+                spans.pop_back();
+            }
+            spans.emplace_back(begin, end);
+        });
+        for (const auto& sp : spans) {
+            for (size_t i = sp.first; i < sp.second; ++i) text[i] = fill;
+        }
+        return matches;
+    }
+
+ private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    uint32_t Child(uint32_t s, uint8_t c) const {
+        auto first = edge_bytes_.begin() + edge_begin_[s];
+        auto last = edge_bytes_.begin() + edge_begin_[s + 1];
+        auto it = std::lower_bound(first, last, c);
+        return (it != last && *it == c) ? edge_targets_[it - edge_bytes_.begin()] : kNone;
+    }
+
+    // goto with failure fallback; the root has a dense table and never fails
+    uint32_t Next(uint32_t s, uint8_t c) const {
+        while (s != 0) {
+            uint32_t t = Child(s, c);
+            if (t != kNone) return t;
+            s = fail_[s];
+        }
+        return root_[c];
+    }
+
+    uint32_t root_[256] = {};
+    std::vector<uint32_t> edge_begin_;   // edges of state s: [edge_begin_[s], edge_begin_[s + 1])
+    std::vector<uint8_t> edge_bytes_;    // sorted within a state
+    std::vector<uint32_t> edge_targets_;
+    std::vector<uint32_t> fail_;
+    std::vector<uint32_t> out_len_;      // 0 = no phrase ends here
+    size_t phrase_count_ = 0;
+};
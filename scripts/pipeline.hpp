@@ -0,0 +1,331 @@
+#pragma once
+// Pipelined file mode: one reader thread cuts the input into batches of lines,
+// N worker threads run the per-line work that only reads shared state
+// (normalization, parsing, jieba.Tag), and the calling thread commits the
+// parsed batches strictly in input order, so the result is identical to the
+// single-threaded loop.
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "utils.hpp"
+#include "line_reader.hpp"
+#include "phrase_matcher.hpp"
+#include "latency_stats.hpp"
+
+// Result of the read-only half of the per-line work.
+struct ParsedLine {
+    enum Kind {
+        kData,        // [HH:MM:SS] sentence, sentence and spans filled
+        kQuery,       // QUERY K=value
+        kWindowSize,  // WINDOW_SIZE = value
+        kNoTime,      // neither a timestamp nor a known command
+        kOutOfRange,  // timestamp outside of the day
+        kUntimed,     // sentence without a timestamp, counted at the current stream time
+    };
+    Kind kind = kNoTime;
+    ll value = 0;     // kData: event time (s); kQuery: minute; kWindowSize: minutes
+    int h = 0, m = 0, s = 0;
+    StageTimes times; // worker stages of this line; the committer adds its own
+    // kData / kUntimed only, both overwritten in place so their buffers are reused
+    std::string sentence;
+    std::vector<cppjieba::WordSpan> spans; // words as byte spans of sentence
+
+    std::string_view word(size_t i) const {
+        return std::string_view(sentence.data() + spans[i].offset, spans[i].len);
+    }
+};
+
+// How phrases of sensitive_words.txt are handled (config key `sensitive_filter`).
+enum class SensitiveFilter {
+    kToken, // "token": drop tokens equal to a phrase, like stop words
+    kMask,  // "mask": blank every occurrence in the sentence before segmentation
+    kDrop,  // "drop": do not segment or count a sentence containing one
+};
+
+inline SensitiveFilter parse_sensitive_filter(const std::string& name) {
+    if (name == "mask") return SensitiveFilter::kMask;
+    if (name == "drop") return SensitiveFilter::kDrop;
+    return SensitiveFilter::kToken;
+}
+
+// Options of the per-line work, fixed for a run.
+struct ParseOptions {
+    bool nfc = false; // sanitize and NFC normalize the raw line first
+    SensitiveFilter sensitive = SensitiveFilter::kToken;
+    const PhraseMatcher* phrases = nullptr; // sensitive phrases, for kMask / kDrop
+    bool untimed = false; // a line that is neither timestamped nor a command is kUntimed, not kNoTime (console)
+};
+
+// Apply the sensitive phrase filter to a normalized sentence. Returns false if
+// the sentence is to be dropped. Masking writes spaces, which segment as
+// separators and are stop words, so a phrase never yields a counted token.
+inline bool filter_sensitive(std::string& sentence, const ParseOptions& opt) {
+    if (opt.phrases == nullptr || opt.sensitive == SensitiveFilter::kToken) return true;
+    if (opt.sensitive == SensitiveFilter::kDrop) return !opt.phrases->Contains(sentence);
+    opt.phrases->Mask(sentence, ' ');
+    return true;
+}
+
+// Classify one input line, then normalize, filter and segment its sentence. `contents` is used as
+// scratch, `scratch` holds the segmenter's buffers of the calling thread. With opt.nfc the raw line
+// is first sanitized and NFC normalized (a no-op for lines that pass the quick check).
+inline void parse_file_line(const cppjieba::Jieba& jieba, std::string& contents, ParsedLine& res,
+                            cppjieba::SegmentScratch& scratch, const ParseOptions& opt = ParseOptions()) {
+    StageTimer timer;
+    res.times.Clear();
+    if (opt.nfc) {
+        normalize_utf8_nfc_in_place(contents);
+        timer.Lap(res.times, kStageNormalize);
+    }
+    std::string action_str = extractAction(contents);
+    if (!checkTime(action_str, res.h, res.m, res.s)) {
+        std::string require = extractSentence(contents);
+        long long new_win = check_window_size(require);
+        if (new_win != -1) {
+            res.kind = ParsedLine::kWindowSize;
+            res.value = new_win;
+        } else {
+            res.value = check_start_time(require);
+            res.kind = (res.value == -1) ? ParsedLine::kNoTime : ParsedLine::kQuery;
+        }
+        if (res.kind != ParsedLine::kNoTime || !opt.untimed) {
+            timer.Lap(res.times, kStageParse);
+            return;
+        }
+        res.kind = ParsedLine::kUntimed; // the whole line is the sentence
+        res.value = 0;
+        res.sentence = contents;
+    } else {
+        res.value = res.h * 3600 + res.m * 60 + res.s;
+        if (res.value > 86400 || res.value < 0) {
+            res.kind = ParsedLine::kOutOfRange;
+            timer.Lap(res.times, kStageParse);
+            return;
+        }
+        res.kind = ParsedLine::kData;
+        res.sentence = extractSentence(contents);
+    }
+    timer.Lap(res.times, kStageParse);
+    normalize_text(res.sentence);
+    timer.Lap(res.times, kStageNormalize);
+    bool keep = filter_sensitive(res.sentence, opt);
+    if (opt.sensitive != SensitiveFilter::kToken) timer.Lap(res.times, kStageFilter);
+    if (!keep) {
+        res.spans.clear(); // the time is still observed, nothing is counted
+        return;
+    }
+    jieba.TagSpans(res.sentence, res.spans, scratch);
+    timer.Lap(res.times, kStageSegment);
+}
+
+struct LineBatch {
+    size_t first_line = 0;  // 0-based index of lines[0] in the stream
+    std::string text;       // the batch's lines back to back
+    std::vector<std::pair<size_t, size_t>> lines; // (offset, length) into text
+    std::vector<ParsedLine> parsed;
+    std::exception_ptr error;
+
+    size_t size() const { return lines.size(); }
+    std::string_view line(size_t i) const {
+        return std::string_view(text.data() + lines[i].first, lines[i].second);
+    }
+};
+
+inline size_t resolve_thread_count(int configured) {
+    if (configured > 0) return static_cast<size_t>(configured);
+    size_t hw = std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+class LinePipeline {
+ public:
+    static const size_t kDefaultBatchLines = 256;
+
+    LinePipeline(const cppjieba::Jieba& jieba, size_t threads, size_t batch_lines = kDefaultBatchLines)
+        : jieba_(jieba), threads_(std::max<size_t>(threads, 1)), batch_lines_(std::max<size_t>(batch_lines, 1)) {
+    }
+
+    // Options for every line parsed from now on; opt.phrases must outlive Run.
+    void SetOptions(const ParseOptions& opt) { opt_ = opt; }
+
+    // Read every line from `reader` and call commit(const LineBatch&) for each
+    // batch in input order. Returns the number of lines read.
+    template <class CommitFn>
+    size_t Run(LineReader& reader, CommitFn commit) {
+        if (threads_ == 1) return RunInline(reader, commit);
+
+        // a fixed pool bounds memory: at most this many batches are in flight
+        const size_t pool_size = threads_ * 4;
+        pool_.resize(pool_size);
+        free_.clear();
+        for (auto& b : pool_) free_.push_back(&b);
+        todo_.clear();
+        done_.assign(pool_size, nullptr);
+        next_read_ = next_commit_ = 0;
+        reader_done_ = false;
+        stop_ = false;
+
+        size_t total_lines = 0;
+        std::thread reader_thread([&] { total_lines = ReadLoop(reader); });
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads_; ++i) workers.emplace_back([this] { WorkLoop(); });
+
+        std::exception_ptr error;
+        while (true) {
+            LineBatch* batch = nullptr;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                committed_cv_.wait(lk, [&] {
+                    return done_[next_commit_ % pool_size] != nullptr || (reader_done_ && next_commit_ == next_read_);
+                });
+                batch = done_[next_commit_ % pool_size];
+                if (batch == nullptr) break;
+                done_[next_commit_ % pool_size] = nullptr;
+            }
+            if (!error) {
+                try {
+                    if (batch->error) std::rethrow_exception(batch->error);
+                    commit(static_cast<const LineBatch&>(*batch));
+                } catch (...) {
+                    error = std::current_exception();
+                    std::lock_guard<std::mutex> lk(mu_);
+                    stop_ = true; // let the reader wind down early
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                ++next_commit_;
+                free_.push_back(batch);
+            }
+            free_cv_.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stop_ = true;
+        }
+        todo_cv_.notify_all();
+        reader_thread.join();
+        for (auto& t : workers) t.join();
+        if (error) std::rethrow_exception(error);
+        return total_lines;
+    }
+
+ private:
+    template <class CommitFn>
+    size_t RunInline(LineReader& reader, CommitFn& commit) {
+        LineBatch batch;
+        cppjieba::SegmentScratch scratch;
+        size_t total = 0;
+        while (Fill(reader, batch, total)) {
+            Parse(batch, scratch);
+            if (batch.error) std::rethrow_exception(batch.error);
+            commit(static_cast<const LineBatch&>(batch));
+            total += batch.size();
+        }
+        return total;
+    }
+
+    bool Fill(LineReader& reader, LineBatch& batch, size_t first_line) {
+        batch.first_line = first_line;
+        batch.text.clear();
+        batch.lines.clear();
+        batch.error = nullptr;
+        std::string_view line;
+        while (batch.lines.size() < batch_lines_ && reader.Next(line)) {
+            batch.lines.emplace_back(batch.text.size(), line.size());
+            batch.text.append(line.data(), line.size());
+        }
+        return !batch.lines.empty();
+    }
+
+    void Parse(LineBatch& batch, cppjieba::SegmentScratch& scratch) {
+        if (batch.parsed.size() < batch.size()) batch.parsed.resize(batch.size());
+        std::string contents;
+        try {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                std::string_view line = batch.line(i);
+                contents.assign(line.data(), line.size());
+                parse_file_line(jieba_, contents, batch.parsed[i], scratch, opt_);
+            }
+        } catch (...) {
+            batch.error = std::current_exception();
+        }
+    }
+
+    size_t ReadLoop(LineReader& reader) {
+        size_t total = 0;
+        while (true) {
+            LineBatch* batch = nullptr;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                free_cv_.wait(lk, [&] { return !free_.empty() || stop_; });
+                if (stop_) break;
+                batch = free_.back();
+                free_.pop_back();
+            }
+            if (!Fill(reader, *batch, total)) {
+                std::lock_guard<std::mutex> lk(mu_);
+                free_.push_back(batch);
+                break;
+            }
+            total += batch->size();
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                todo_.emplace_back(next_read_++, batch);
+            }
+            todo_cv_.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            reader_done_ = true;
+        }
+        todo_cv_.notify_all();
+        committed_cv_.notify_one();
+        return total;
+    }
+
+    void WorkLoop() {
+        cppjieba::SegmentScratch scratch; // per worker, reused for every line it parses
+        while (true) {
+            std::pair<size_t, LineBatch*> job;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                todo_cv_.wait(lk, [&] { return !todo_.empty() || reader_done_ || stop_; });
+                if (todo_.empty()) return;
+                job = todo_.front();
+                todo_.pop_front();
+            }
+            Parse(*job.second, scratch);
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                done_[job.first % pool_.size()] = job.second;
+            }
+            committed_cv_.notify_one();
+        }
+    }
+
+    const cppjieba::Jieba& jieba_;
+    size_t threads_;
+    size_t batch_lines_;
+    ParseOptions opt_;
+
+    std::mutex mu_;
+    std::condition_variable free_cv_;      // reader waits for a free batch
+    std::condition_variable todo_cv_;      // workers wait for a filled batch
+    std::condition_variable committed_cv_; // committer waits for the next batch in order
+    std::vector<LineBatch> pool_;
+    std::vector<LineBatch*> free_;
+    std::deque<std::pair<size_t, LineBatch*>> todo_;
+    std::vector<LineBatch*> done_;         // slot seq % pool size, filled by workers
+    size_t next_read_ = 0;
+    size_t next_commit_ = 0;
+    bool reader_done_ = false;
+    bool stop_ = false;
+};
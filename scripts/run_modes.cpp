@@ -0,0 +1,180 @@
+#include "run_modes.hpp"
+#include "engine.hpp"
+#include "server.hpp"
+#include <chrono>
+#include <csignal>
+
+int deal_with_file_input(cppjieba::Jieba& jieba, const Config& cfg) {
+    using Clock = std::chrono::steady_clock;
+    auto t_begin = Clock::now();
+
+    std::string inputpath = std::string(INPUT_ROOT_DIR) + "/" + cfg.inputFile;
+    std::string outputpath = std::string(OUTPUT_ROOT_DIR) + "/" + cfg.outputFile;
+
+    std::ofstream out(outputpath, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "[ERROR] cannot open output file: " << outputpath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    out << "===== cppjieba segmentation =====";
+    out << "\nInputFile: " << inputpath << "\n";
+    out << "OutputFile: " << outputpath << "\n";
+    out << "JiebaMode: " << cfg.jiebamode << "\n";
+
+    HotWordsEngine engine(jieba, cfg); // 词表 + 滑动窗口 + 历史，全部以词 id 存储
+
+    // 流式读取输入文件：按行取 string_view，不把整个文件读进内存
+    LineReader reader;
+    if (!reader.Open(inputpath)) {
+        std::cerr << "[ERROR] cannot open input file: " << inputpath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // 读取/分词在工作线程中并行执行，计数与查询在本线程按输入顺序提交，结果与单线程一致
+    size_t threads = resolve_thread_count(cfg.threads);
+    out << "Threads: " << threads << "\n";
+
+    size_t idx = engine.IngestStream(reader, threads, [&](const ParsedLine& pl, size_t line) {
+        engine.WriteLineResult(out, pl, line);
+    });
+    reader.Close();
+
+    if (idx == 0) {
+        std::cout << "[INFO] input file is empty: " << inputpath << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "[INFO] read " << idx << " lines from " << inputpath << std::endl;
+
+    double elapsed_sec = std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - t_begin).count();
+    out << "===================================\n";
+    out << "LineCount: " << idx << "\n";
+    engine.WriteMetrics(out, engine.processed_lines(), elapsed_sec, outputpath);
+
+    out.close();
+    return EXIT_SUCCESS;
+}
+
+int deal_with_console_input(cppjieba::Jieba& jieba, const Config& cfg) {
+    std::string outputpath = std::string(OUTPUT_ROOT_DIR) + "/" + cfg.outputFile;
+
+    std::ofstream out(outputpath, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "[ERROR] cannot open output file: " << outputpath << std::endl;
+        return EXIT_FAILURE;
+    }
+    out << "===== cppjieba segmentation =====";
+    out << "Choosing console_input_mode\n";
+    out << "OutputFile: " << outputpath << "\n";
+    out << "JiebaMode: " << cfg.jiebamode << "\n";
+
+    HotWordsEngine engine(jieba, cfg);
+    engine.SetUntimed(true); // 无时间戳的句子使用当前时间
+
+    long long line_count = 0;
+    std::cout << "==========================================================" << std::endl;
+    //std::cout << "[IMPORTANT] If on Windows, run 'chcp 65001' first." << std::endl;
+    std::cout << "Input format:" << std::endl;
+    std::cout << "  1. [HH:MM:SS] Sentence  -> Set explicit time." << std::endl;
+    std::cout << "  2. Sentence             -> Use current time (" << engine.counter().time_range() << " min window)." << std::endl;
+    std::cout << "  3. [ACTION] QUERY K=15  -> Query hot words at minute 15." << std::endl;
+    std::cout << "  4. [ACTION] WINDOW_SIZE=10 -> Adjust time window to 10 minutes." << std::endl;
+    std::cout << "Type 'exit' to quit." << std::endl;
+    std::cout << "==========================================================" << std::endl;
+
+    while (true) {
+        std::string content;
+        std::cout << "> ";
+        if (!std::getline(std::cin, content)) break; // 输入结束 (管道关闭)
+
+        if (content == "exit") break;
+        if (content.empty()) continue;
+        if (content.back() == '\r') content.pop_back();
+
+        line_count++;
+
+        try {
+            // 指令/时间解析、归一、分词、计数与查询都在引擎中逐阶段计时，终端输出不计入
+            const ParsedLine& pl = engine.IngestLine(content);
+            if (pl.kind == ParsedLine::kWindowSize) {
+                std::cout << "[INFO] time_range updated to " << engine.counter().time_range() << " min" << std::endl;
+                out << "[INFO] time_range updated to " << engine.counter().time_range() << " min\n";
+            } else if (pl.kind == ParsedLine::kUntimed) {
+                ll currtime = engine.counter().current_time();
+                int cur_h = (currtime / 3600) % 24;
+                int cur_m = (currtime % 3600) / 60;
+                int cur_s = currtime % 60;
+                std::cout << "[INFO] No timestamp. Defaulting to current time: "
+                          << cur_h << ":" << cur_m << ":" << cur_s << std::endl;
+            } else if (pl.kind == ParsedLine::kQuery) {
+                out << "Query Time: " << pl.value << " minute" << "\n";
+                std::cout << "Querying Top " << cfg.topk << " words at minute " << pl.value << ", window size = " << engine.counter().time_range() << " minutes" << std::endl;
+                if (engine.top().empty()) std::cout << "No hot words found." << std::endl;
+                engine.WriteTop(out);
+                engine.WriteTop(std::cout);
+                std::cout.flush();
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] " << e.what() << std::endl;
+        }
+    }
+
+    std::cout<< "保存到文件: " << outputpath << std::endl;
+    out << "===================================\n";
+    out << "Total lines processed: " << line_count << "\n";
+    engine.WriteMetrics(out, line_count, engine.processing_ns() / 1e9, outputpath);
+    out.close();
+    return EXIT_SUCCESS;
+}
+
+static HotWordsServer* g_server = nullptr;
+
+// 第一次 Ctrl+C 让服务发完剩余响应后退出，第二次直接结束进程
+static void stop_server(int sig) {
+    if (g_server != nullptr) g_server->Stop();
+    std::signal(sig, SIG_DFL);
+}
+
+int deal_with_server(cppjieba::Jieba& jieba, const Config& cfg) {
+    using Clock = std::chrono::steady_clock;
+    auto t_begin = Clock::now();
+
+    std::string outputpath = std::string(OUTPUT_ROOT_DIR) + "/" + cfg.outputFile;
+    std::ofstream out(outputpath, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "[ERROR] cannot open output file: " << outputpath << std::endl;
+        return EXIT_FAILURE;
+    }
+    out << "===== cppjieba segmentation =====";
+    out << "\nServer: " << cfg.server_listen << "\n";
+    out << "OutputFile: " << outputpath << "\n";
+    out << "JiebaMode: " << cfg.jiebamode << "\n";
+
+    // 词典只加载一次，所有客户端共用同一个引擎；请求在单线程中按到达顺序执行
+    HotWordsEngine engine(jieba, cfg);
+    HotWordsServer server(engine);
+    if (!server.Listen(cfg.server_listen)) {
+        std::cerr << "[ERROR] cannot listen on " << cfg.server_listen << ": " << server.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "[INFO] listening on " << server.address() << " (SHUTDOWN or Ctrl+C to stop)" << std::endl;
+
+    g_server = &server;
+    std::signal(SIGINT, stop_server);
+    std::signal(SIGTERM, stop_server);
+    server.Run();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    g_server = nullptr;
+    if (!server.error().empty()) std::cerr << "[ERROR] " << server.error() << std::endl;
+    std::cout << "[INFO] server stopped after " << server.requests() << " requests" << std::endl;
+
+    // 服务时长内的吞吐与延迟
+    double elapsed_sec = std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - t_begin).count();
+    out << "===================================\n";
+    out << "Requests: " << server.requests() << "\n";
+    out << "Total lines processed: " << engine.processed_lines() << "\n";
+    engine.WriteMetrics(out, engine.processed_lines(), elapsed_sec, outputpath);
+    out.close();
+    return server.error().empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,17 @@
+#pragma once
+// Front ends of the hotwords app, built into hotwords_core so that the app and
+// the unit tests run the same code. Each returns EXIT_SUCCESS or EXIT_FAILURE.
+#include "Jieba.hpp"
+#include "utils.hpp"
+
+// work_type = 1: input/<input_file> through the pipeline, results and
+// metrics to output/<output_file>.
+int deal_with_file_input(cppjieba::Jieba& jieba, const Config& cfg);
+
+// work_type = 2: lines typed on stdin until "exit", results to stdout and
+// output/<output_file>.
+int deal_with_console_input(cppjieba::Jieba& jieba, const Config& cfg);
+
+// work_type = 3: serve the protocol in server.hpp on cfg.server_listen until
+// SHUTDOWN, SIGINT or SIGTERM, then write the metrics to output/<output_file>.
+int deal_with_server(cppjieba::Jieba& jieba, const Config& cfg);
@@ -0,0 +1,589 @@
+// winsock2.h has to come before windows.h, which utils.hpp pulls in
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+#include "server.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include "memory_stats.hpp"
+
+namespace {
+
+const SocketHandle kNoSocket = -1;
+const size_t kMaxLine = 1 << 20;           // longest header or input line
+const size_t kMaxPendingOutput = 16 << 20; // a client that does not read its responses is not read either
+const size_t kReadPerPoll = 1 << 20;       // so that one busy client cannot starve the others
+const int kPollMs = 200;                   // how soon Stop() is noticed
+const int kDrainMs = 5000;                 // after Stop(), how long clients get to read what is left
+const long long kMinutesPerDay = 1440;     // input times lie within one day
+
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL; // a closed peer is an error, not SIGPIPE
+#else
+const int kSendFlags = 0;
+#endif
+
+#ifdef _WIN32
+typedef WSAPOLLFD PollFd;
+typedef SOCKET NativeSocket;
+
+void net_init() {
+    struct Init {
+        Init() { WSADATA d; WSAStartup(MAKEWORD(2, 2), &d); }
+        ~Init() { WSACleanup(); }
+    };
+    static Init init;
+}
+int poll_sockets(PollFd* fds, size_t n, int ms) { return WSAPoll(fds, static_cast<ULONG>(n), ms); }
+void close_socket(SocketHandle s) { closesocket(static_cast<SOCKET>(s)); }
+bool would_block() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+bool interrupted() { return false; }
+bool set_nonblocking(SocketHandle s) {
+    u_long on = 1;
+    return ioctlsocket(static_cast<SOCKET>(s), FIONBIO, &on) == 0;
+}
+std::string last_error() { return "winsock error " + std::to_string(WSAGetLastError()); }
+#else
+typedef pollfd PollFd;
+typedef int NativeSocket;
+
+void net_init() {}
+int poll_sockets(PollFd* fds, size_t n, int ms) { return poll(fds, static_cast<nfds_t>(n), ms); }
+void close_socket(SocketHandle s) { close(static_cast<int>(s)); }
+bool would_block() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+bool interrupted() { return errno == EINTR; }
+bool set_nonblocking(SocketHandle s) {
+    int flags = fcntl(static_cast<int>(s), F_GETFL, 0);
+    return flags != -1 && fcntl(static_cast<int>(s), F_SETFL, flags | O_NONBLOCK) == 0;
+}
+std::string last_error() { return std::strerror(errno); }
+#endif
+
+NativeSocket native(SocketHandle s) { return static_cast<NativeSocket>(s); }
+
+void no_sigpipe(SocketHandle s) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(native(s), SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)s;
+#endif
+}
+
+struct Endpoint {
+    bool is_unix = false;
+    std::string host, port; // tcp
+    std::string path;       // unix
+};
+
+bool parse_endpoint(const std::string& spec, Endpoint& ep, std::string& error) {
+    if (spec.rfind("unix:", 0) == 0 && spec.size() > 5) {
+        ep.is_unix = true;
+        ep.path = spec.substr(5);
+        return true;
+    }
+    size_t colon = spec.rfind(':');
+    if (spec.rfind("tcp:", 0) == 0 && colon > 3 && colon + 1 < spec.size()) {
+        ep.host = spec.substr(4, colon - 4);
+        ep.port = spec.substr(colon + 1);
+        if (ep.host.size() >= 2 && ep.host.front() == '[' && ep.host.back() == ']') {
+            ep.host = ep.host.substr(1, ep.host.size() - 2); // [::1]
+        }
+        return true;
+    }
+    error = "bad address '" + spec + "', expected tcp:<host>:<port> or unix:<path>";
+    return false;
+}
+
+// A listening (listen = true) or connected socket for ep; kNoSocket with
+// error set on failure. bound_port receives the TCP port actually bound.
+SocketHandle open_socket(const Endpoint& ep, bool listen_mode, std::string& error, int* bound_port) {
+    if (ep.is_unix) {
+#ifdef _WIN32
+        (void)listen_mode;
+        (void)bound_port;
+        error = "unix sockets are not supported on Windows, use tcp:<host>:<port>";
+        return kNoSocket;
+#else
+        sockaddr_un addr{};
+        if (ep.path.size() >= sizeof(addr.sun_path)) {
+            error = "unix socket path too long: " + ep.path;
+            return kNoSocket;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, ep.path.c_str(), ep.path.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            error = last_error();
+            return kNoSocket;
+        }
+        if (listen_mode) {
+            // a socket file left by a server that did not shut down cleanly;
+            // anything else at that path is left alone and bind() fails
+            struct stat st;
+            if (stat(ep.path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(ep.path.c_str());
+        }
+        int rc = listen_mode ? bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+                             : connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if (rc != 0 || (listen_mode && listen(fd, SOMAXCONN) != 0)) {
+            error = ep.path + ": " + last_error();
+            close(fd);
+            return kNoSocket;
+        }
+        return fd;
+#endif
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listen_mode ? AI_PASSIVE : 0;
+    addrinfo* res = nullptr;
+    int gai = getaddrinfo(ep.host.empty() ? nullptr : ep.host.c_str(), ep.port.c_str(), &hints, &res);
+    if (gai != 0) {
+        error = ep.host + ":" + ep.port + ": " + gai_strerror(gai);
+        return kNoSocket;
+    }
+    SocketHandle fd = kNoSocket;
+    for (addrinfo* ai = res; ai != nullptr; ai = ai->ai_next) {
+        SocketHandle s = static_cast<SocketHandle>(socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+        if (s == kNoSocket) continue;
+        int on = 1;
+        int rc;
+        if (listen_mode) {
+            setsockopt(native(s), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+            rc = bind(native(s), ai->ai_addr, static_cast<int>(ai->ai_addrlen));
+            if (rc == 0) rc = listen(native(s), SOMAXCONN);
+        } else {
+            rc = connect(native(s), ai->ai_addr, static_cast<int>(ai->ai_addrlen));
+        }
+        if (rc == 0) {
+            setsockopt(native(s), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+            fd = s;
+            break;
+        }
+        error = ep.host + ":" + ep.port + ": " + last_error();
+        close_socket(s);
+    }
+    freeaddrinfo(res);
+    if (fd != kNoSocket && bound_port != nullptr) {
+        sockaddr_storage addr{};
+        socklen_t len = sizeof(addr);
+        if (getsockname(native(fd), reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+            if (addr.ss_family == AF_INET) *bound_port = ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+            else if (addr.ss_family == AF_INET6) *bound_port = ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port);
+        }
+    }
+    return fd;
+}
+
+// Non-negative decimal that fits in a long long, nothing else.
+bool parse_count(std::string_view s, long long& v) {
+    if (s.empty() || s.size() > 18) return false;
+    v = 0;
+    for (char ch : s) {
+        if (ch < '0' || ch > '9') return false;
+        v = v * 10 + (ch - '0');
+    }
+    return true;
+}
+
+std::vector<std::string_view> split_words(std::string_view line) {
+    std::vector<std::string_view> words;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) ++i;
+        size_t j = i;
+        while (j < line.size() && line[j] != ' ' && line[j] != '\t') ++j;
+        if (j > i) words.push_back(line.substr(i, j - i));
+        i = j;
+    }
+    return words;
+}
+
+size_t count_lines(const std::string& body) {
+    return static_cast<size_t>(std::count(body.begin(), body.end(), '\n'));
+}
+
+} // namespace
+
+struct HotWordsServer::Connection {
+    SocketHandle fd = kNoSocket;
+    std::string in;        // received, not processed yet
+    std::string out;       // responses not sent yet, from out_pos on
+    size_t out_pos = 0;
+    bool eof = false;      // the peer sent everything it will send
+    bool quit = false;     // QUIT, SHUTDOWN or a framing error: close once out is sent
+    // INGEST in progress
+    long long ingest_left = 0;
+    long long ingest_lines = 0;
+    long long ingest_skipped = 0;
+    std::ostringstream ingest_body;
+    bool ingest_dropped = false; // the body outgrew kMaxPendingOutput and was discarded
+
+    size_t pending() const { return out.size() - out_pos; }
+    size_t body_size() { return static_cast<size_t>(ingest_body.tellp()); }
+    // output held for this client, sent or still being built
+    size_t buffered() { return pending() + body_size(); }
+};
+
+HotWordsServer::HotWordsServer(HotWordsEngine& engine) : engine_(engine), listen_fd_(kNoSocket) {
+    net_init();
+}
+
+HotWordsServer::~HotWordsServer() {
+    while (!conns_.empty()) CloseConnection(conns_.size() - 1);
+    if (listen_fd_ != kNoSocket) close_socket(listen_fd_);
+#ifndef _WIN32
+    if (!unix_path_.empty()) unlink(unix_path_.c_str());
+#endif
+}
+
+bool HotWordsServer::Listen(const std::string& spec) {
+    Endpoint ep;
+    if (!parse_endpoint(spec, ep, error_)) return false;
+    listen_fd_ = open_socket(ep, true, error_, &port_);
+    if (listen_fd_ == kNoSocket) return false;
+    if (!set_nonblocking(listen_fd_)) {
+        error_ = last_error();
+        return false;
+    }
+    if (ep.is_unix) {
+        unix_path_ = ep.path;
+        address_ = "unix:" + ep.path;
+    } else {
+        address_ = "tcp:" + ep.host + ":" + std::to_string(port_);
+    }
+    return true;
+}
+
+void HotWordsServer::Run() {
+    using Clock = std::chrono::steady_clock;
+    std::vector<PollFd> fds;
+    Clock::time_point drain_deadline;
+    bool draining = false;
+    while (true) {
+        bool stopping = stop_.load();
+        if (stopping) {
+            // stop accepting and reading; leave once every response is out, or
+            // after kDrainMs even if a client stopped reading
+            if (!draining) drain_deadline = Clock::now() + std::chrono::milliseconds(kDrainMs);
+            draining = true;
+            bool pending = false;
+            for (auto& c : conns_) pending = pending || c->pending() > 0;
+            if (!pending || Clock::now() >= drain_deadline) break;
+        }
+        fds.clear();
+        PollFd lfd{};
+        lfd.fd = native(listen_fd_);
+        lfd.events = stopping ? 0 : POLLIN;
+        fds.push_back(lfd);
+        for (auto& c : conns_) {
+            PollFd p{};
+            p.fd = native(c->fd);
+            if (!stopping && !c->eof && !c->quit && c->buffered() < kMaxPendingOutput) p.events |= POLLIN;
+            if (c->pending() > 0) p.events |= POLLOUT;
+            fds.push_back(p);
+        }
+        int n = poll_sockets(fds.data(), fds.size(), kPollMs);
+        if (n < 0) {
+            if (interrupted()) continue;
+            error_ = last_error();
+            break;
+        }
+        if (n == 0) continue;
+
+        // from the back, so that closing a connection does not move the unvisited ones
+        for (size_t i = conns_.size(); i-- > 0;) {
+            Connection& c = *conns_[i];
+            short revents = fds[i + 1].revents;
+            bool ok = true;
+            if (revents & POLLIN) ok = Receive(c);
+            else if (revents & (POLLERR | POLLHUP | POLLNVAL)) ok = c.pending() == 0 && (c.eof = true);
+            // process and send until the input holds no complete line or the
+            // client stops taking responses
+            while (ok) {
+                Process(c);
+                ok = Flush(c);
+                if (c.quit || c.pending() > 0 || c.in.find('\n') == std::string::npos) break;
+            }
+            if (!ok || ((c.quit || c.eof) && c.pending() == 0)) CloseConnection(i);
+        }
+        if (fds[0].revents & POLLIN) Accept();
+    }
+    while (!conns_.empty()) CloseConnection(conns_.size() - 1);
+}
+
+void HotWordsServer::Accept() {
+    while (true) {
+        SocketHandle s = static_cast<SocketHandle>(accept(native(listen_fd_), nullptr, nullptr));
+        if (s == kNoSocket) return; // nothing more to accept, or a transient error
+        if (!set_nonblocking(s)) {
+            close_socket(s);
+            continue;
+        }
+        no_sigpipe(s);
+        if (unix_path_.empty()) {
+            int on = 1;
+            setsockopt(native(s), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+        }
+        conns_.emplace_back(new Connection());
+        conns_.back()->fd = s;
+    }
+}
+
+bool HotWordsServer::Receive(Connection& c) {
+    char buf[64 * 1024];
+    size_t got = 0;
+    while (got < kReadPerPoll) {
+        int n = static_cast<int>(recv(native(c.fd), buf, sizeof(buf), 0));
+        if (n > 0) {
+            c.in.append(buf, static_cast<size_t>(n));
+            got += static_cast<size_t>(n);
+            continue;
+        }
+        if (n == 0) {
+            c.eof = true; // answer what was sent, then close
+            return true;
+        }
+        return would_block() || interrupted();
+    }
+    return true;
+}
+
+bool HotWordsServer::Flush(Connection& c) {
+    while (c.pending() > 0) {
+        size_t chunk = std::min<size_t>(c.pending(), 1 << 20);
+        int n = static_cast<int>(send(native(c.fd), c.out.data() + c.out_pos, static_cast<int>(chunk), kSendFlags));
+        if (n > 0) {
+            c.out_pos += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && (would_block() || interrupted())) break;
+        return false;
+    }
+    if (c.out_pos == c.out.size()) {
+        c.out.clear();
+        c.out_pos = 0;
+    } else if (c.out_pos > (1 << 20)) {
+        c.out.erase(0, c.out_pos);
+        c.out_pos = 0;
+    }
+    return true;
+}
+
+void HotWordsServer::Process(Connection& c) {
+    size_t pos = 0;
+    while (!c.quit && c.buffered() < kMaxPendingOutput) {
+        size_t nl = c.in.find('\n', pos);
+        if (nl == std::string::npos) break;
+        std::string_view line(c.in.data() + pos, nl - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        pos = nl + 1;
+        if (c.ingest_left == 0) {
+            ++requests_;
+            Handle(c, line);
+            continue;
+        }
+        // one line of an INGEST batch; the file mode's output for it goes to the body
+        const ParsedLine& pl = engine_.IngestLine(line);
+        if (pl.kind == ParsedLine::kNoTime || pl.kind == ParsedLine::kOutOfRange) ++c.ingest_skipped;
+        if (!c.ingest_dropped) engine_.WriteLineResult(c.ingest_body, pl, static_cast<size_t>(c.ingest_lines));
+        ++c.ingest_lines;
+        if (!c.ingest_dropped && c.body_size() >= kMaxPendingOutput) {
+            // the body can only be sent once the batch is complete, so it cannot
+            // wait for the client like other output: drop it, keep ingesting
+            c.ingest_dropped = true;
+            c.ingest_body.str("");
+            c.ingest_body.clear();
+        }
+        if (--c.ingest_left == 0) {
+            std::string counts = "lines=" + std::to_string(c.ingest_lines) + " skipped=" + std::to_string(c.ingest_skipped);
+            if (c.ingest_dropped) {
+                Fail(c, "INGEST output exceeded " + std::to_string(kMaxPendingOutput) + " bytes and was dropped, " + counts +
+                        " were ingested; send smaller batches");
+            } else {
+                Reply(c, counts, c.ingest_body.str());
+            }
+            c.ingest_body.str("");
+            c.ingest_body.clear();
+            c.ingest_dropped = false;
+        }
+    }
+    c.in.erase(0, pos);
+    if (!c.quit && c.in.size() > kMaxLine && c.in.find('\n') == std::string::npos) {
+        Fail(c, "line longer than " + std::to_string(kMaxLine) + " bytes");
+        c.quit = true;
+        c.in.clear();
+    }
+}
+
+void HotWordsServer::Handle(Connection& c, std::string_view header) {
+    std::vector<std::string_view> args = split_words(header);
+    if (args.empty()) {
+        Fail(c, "empty request");
+        return;
+    }
+    std::string_view verb = args[0];
+    long long a = 0, b = 0;
+    if (verb == "INGEST") {
+        if (args.size() != 2 || !parse_count(args[1], a)) {
+            // the batch length is unknown, so the rest of the stream cannot be framed
+            Fail(c, "usage: INGEST <line count>");
+            c.quit = true;
+            return;
+        }
+        c.ingest_left = a;
+        c.ingest_lines = c.ingest_skipped = 0;
+        if (a == 0) Reply(c, "lines=0 skipped=0", "");
+    } else if (verb == "QUERY") {
+        if (args.size() < 2 || args.size() > 3 || !parse_count(args[1], a) ||
+            (args.size() == 3 && (!parse_count(args[2], b) || b == 0))) {
+            Fail(c, "usage: QUERY <minute> [k]");
+            return;
+        }
+        if (a >= kMinutesPerDay) {
+            Fail(c, "minute out of range 0.." + std::to_string(kMinutesPerDay - 1));
+            return;
+        }
+        engine_.Query(a, args.size() == 3 ? static_cast<size_t>(b) : engine_.topk());
+        std::ostringstream body;
+        engine_.WriteTop(body);
+        Reply(c, "minute=" + std::to_string(a) + " time_range=" + std::to_string(engine_.counter().time_range()), body.str());
+    } else if (verb == "WINDOW_SIZE") {
+        if (args.size() != 2 || !parse_count(args[1], a) || a == 0) {
+            Fail(c, "usage: WINDOW_SIZE <minutes>");
+            return;
+        }
+        if (a > kMinutesPerDay) {
+            Fail(c, "window out of range 1.." + std::to_string(kMinutesPerDay) + " minutes");
+            return;
+        }
+        engine_.SetWindowSize(a);
+        Reply(c, "time_range=" + std::to_string(engine_.counter().time_range()), "");
+    } else if (verb == "STATS") {
+        const HotWordCounter& counter = engine_.counter();
+        std::ostringstream body;
+        body << "lines: " << engine_.processed_lines() << "\n";
+        body << "requests: " << requests_ << "\n";
+        body << "connections: " << conns_.size() << "\n";
+        body << "vocab: " << counter.vocab().Size() << "\n";
+        body << "current_time: " << counter.current_time() << "\n";
+        body << "time_range: " << counter.time_range() << "\n";
+        body << "AvgLatency(ms/line): "
+             << (engine_.processed_lines() > 0 ? engine_.processing_ns() / 1e6 / engine_.processed_lines() : 0.0) << "\n";
+        write_memory_report(body, engine_.jieba(), counter);
+        engine_.latency().WriteReport(body);
+        Reply(c, "", body.str());
+    } else if (verb == "QUIT") {
+        Reply(c, "", "");
+        c.quit = true;
+    } else if (verb == "SHUTDOWN") {
+        Reply(c, "", "");
+        c.quit = true;
+        Stop();
+    } else {
+        Fail(c, "unknown request: " + std::string(verb));
+    }
+}
+
+void HotWordsServer::Reply(Connection& c, const std::string& fields, const std::string& body) {
+    c.out += "OK " + std::to_string(count_lines(body));
+    if (!fields.empty()) c.out += " " + fields;
+    c.out += "\n";
+    c.out += body;
+}
+
+void HotWordsServer::Fail(Connection& c, const std::string& message) {
+    c.out += "ERR " + message + "\n";
+}
+
+void HotWordsServer::CloseConnection(size_t i) {
+    close_socket(conns_[i]->fd);
+    conns_.erase(conns_.begin() + static_cast<std::ptrdiff_t>(i));
+}
+
+HotWordsClient::HotWordsClient() : fd_(kNoSocket) {
+    net_init();
+}
+
+HotWordsClient::~HotWordsClient() {
+    Close();
+}
+
+bool HotWordsClient::Connect(const std::string& spec) {
+    Close();
+    Endpoint ep;
+    std::string error;
+    if (!parse_endpoint(spec, ep, error)) return false;
+    fd_ = open_socket(ep, false, error, nullptr);
+    if (fd_ != kNoSocket) no_sigpipe(fd_);
+    return fd_ != kNoSocket;
+}
+
+bool HotWordsClient::Send(std::string_view data) {
+    while (!data.empty() && fd_ != kNoSocket) {
+        int n = static_cast<int>(send(native(fd_), data.data(), static_cast<int>(std::min<size_t>(data.size(), 1 << 20)), kSendFlags));
+        if (n <= 0) {
+            if (n < 0 && interrupted()) continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return fd_ != kNoSocket;
+}
+
+bool HotWordsClient::ReadLine(std::string& line) {
+    while (true) {
+        size_t nl = in_.find('\n', pos_);
+        if (nl != std::string::npos) {
+            line.assign(in_, pos_, nl - pos_);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            pos_ = nl + 1;
+            if (pos_ > (1 << 16)) {
+                in_.erase(0, pos_);
+                pos_ = 0;
+            }
+            return true;
+        }
+        if (fd_ == kNoSocket) return false;
+        char buf[64 * 1024];
+        int n = static_cast<int>(recv(native(fd_), buf, sizeof(buf), 0));
+        if (n < 0 && interrupted()) continue;
+        if (n <= 0) return false;
+        in_.append(buf, static_cast<size_t>(n));
+    }
+}
+
+bool HotWordsClient::ReadResponse(std::string& header, std::vector<std::string>& body) {
+    body.clear();
+    if (!ReadLine(header)) return false;
+    if (header.rfind("OK ", 0) != 0) return header.rfind("ERR", 0) == 0;
+    long long lines = std::atoll(header.c_str() + 3);
+    body.resize(static_cast<size_t>(std::max(0LL, lines)));
+    for (std::string& l : body) {
+        if (!ReadLine(l)) return false;
+    }
+    return true;
+}
+
+void HotWordsClient::Close() {
+    if (fd_ != kNoSocket) close_socket(fd_);
+    fd_ = kNoSocket;
+    in_.clear();
+    pos_ = 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+// Long-running server mode (work_type = 3): the dictionary is loaded once and
+// one HotWordsEngine serves any number of clients on a local TCP or Unix
+// socket. A single thread polls every connection, so requests from all
+// clients are applied to the engine one at a time, in arrival order, with no
+// locking.
+//
+// Protocol: text lines ending in "\n" ("\r\n" accepted). A request is one
+// header line, and a response is one header line plus as many body lines as
+// the header announces:
+//
+//   INGEST <n>           the next n lines are input lines, exactly as in an
+//                        input file ([HH:MM:SS] sentence, [ACTION] QUERY K=m,
+//                        [ACTION] WINDOW_SIZE=m); the body holds what the
+//                        file mode would write for them
+//                        -> OK <body lines> lines=<n> skipped=<not understood>
+//                        (ERR if that body would exceed 16 MiB; the lines
+//                        are still ingested)
+//   QUERY <minute> [k]   Top-k at minute 0..1439 (k defaults to the configured topk)
+//                        -> OK <rows> minute=<m> time_range=<w>, rows "rank: word/tag/count"
+//   WINDOW_SIZE <min>    window of 1..1440 minutes -> OK 0 time_range=<w>
+//   STATS                -> OK <lines> with "key: value" lines, the memory
+//                        breakdown and the stage latency table
+//   QUIT                 -> OK 0, then the server closes the connection
+//   SHUTDOWN             -> OK 0, then the server stops
+//   anything else        -> ERR <message>
+//
+// Clients may pipeline: send any number of requests without waiting, and
+// read the responses, which come back in request order.
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "engine.hpp"
+
+typedef std::intptr_t SocketHandle; // int on POSIX, SOCKET on Windows
+
+class HotWordsServer {
+ public:
+    explicit HotWordsServer(HotWordsEngine& engine);
+    ~HotWordsServer();
+    HotWordsServer(const HotWordsServer&) = delete;
+    HotWordsServer& operator=(const HotWordsServer&) = delete;
+
+    // Bind to "tcp:<host>:<port>" (port 0 picks a free one) or
+    // "unix:<path>". Returns false and sets error() on failure.
+    bool Listen(const std::string& spec);
+    // Serve until SHUTDOWN or Stop(); pending responses are sent first, for
+    // at most a few seconds.
+    void Run();
+    // Make Run() return within a poll interval; safe from another thread or
+    // a signal handler.
+    void Stop() { stop_.store(true); }
+
+    const std::string& error() const { return error_; }
+    int port() const { return port_; }           // bound TCP port
+    std::string address() const { return address_; }
+    long long requests() const { return requests_; }
+    size_t connections() const { return conns_.size(); }
+
+ private:
+    struct Connection;
+
+    void Accept();
+    bool Receive(Connection& c);   // false when reading failed
+    bool Flush(Connection& c);     // false when sending failed
+    void Process(Connection& c);   // complete lines in c.in, in order
+    void Handle(Connection& c, std::string_view header);
+    void Reply(Connection& c, const std::string& fields, const std::string& body); // "OK <body lines> fields"
+    void Fail(Connection& c, const std::string& message);                          // "ERR message"
+    void CloseConnection(size_t i);
+
+    HotWordsEngine& engine_;
+    SocketHandle listen_fd_;
+    std::string unix_path_;        // removed again on close
+    std::string address_;
+    int port_ = 0;
+    std::string error_;
+    std::vector<std::unique_ptr<Connection>> conns_;
+    std::atomic<bool> stop_{false};
+    long long requests_ = 0;
+};
+
+// Blocking client for the protocol above, for tests and tools.
+class HotWordsClient {
+ public:
+    HotWordsClient();
+    ~HotWordsClient();
+    HotWordsClient(const HotWordsClient&) = delete;
+    HotWordsClient& operator=(const HotWordsClient&) = delete;
+
+    // Same address syntax as HotWordsServer::Listen.
+    bool Connect(const std::string& spec);
+    // Raw bytes: one request, part of one, or several pipelined ones.
+    bool Send(std::string_view data);
+    // The next response: its header line and the body lines it announces.
+    bool ReadResponse(std::string& header, std::vector<std::string>& body);
+    void Close();
+
+ private:
+    bool ReadLine(std::string& line);
+
+    SocketHandle fd_;
+    std::string in_;
+    size_t pos_ = 0;
+};
@@ -0,0 +1,281 @@
+// hotwords_gen: synthetic danmaku streams for scaling tests.
+// Writes `[HH:MM:SS] sentence` lines spread evenly over one day (the range
+// the parser accepts), with words drawn from the jieba dictionary under a
+// Zipf law, burst events that push one word for a while, a share of late
+// (out of order) lines, and interleaved QUERY / WINDOW_SIZE commands.
+// The same seed and options always give the same stream: the generator has
+// its own PRNG and samplers instead of the implementation-defined
+// std:: distributions.
+//
+// Usage: hotwords_gen [--lines N] [--seed S] [--out FILE] [--dict FILE]
+//                     [--vocab N] [--zipf S] [--words MIN MAX] [--spaces]
+//                     [--bursts N] [--burst-secs N] [--burst-share P]
+//                     [--late-rate P] [--late-max SECS]
+//                     [--query-every N] [--window-every N]
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const long long kDaySeconds = 86400;
+
+struct GenOptions {
+    long long lines = 1000000;
+    uint64_t seed = 1;
+    std::string out;          // empty = stdout
+    std::string dict = std::string(JIEBA_DICT_DIR) + "/jieba.dict.utf8";
+    size_t vocab = 50000;     // most frequent dictionary words used
+    double zipf = 1.0;        // exponent s: P(rank r) ~ 1 / r^s
+    int min_words = 2;
+    int max_words = 8;
+    bool spaces = false;      // separate words by spaces (default: run together, as danmaku are)
+    int bursts = 24;          // burst events over the day
+    int burst_secs = 180;
+    double burst_share = 0.4; // share of lines in a burst that carry its word
+    double late_rate = 0.01;  // share of lines stamped earlier than their position
+    int late_max = 120;       // seconds
+    long long query_every = 10000;  // lines between QUERY commands, 0 = none
+    long long window_every = 0;     // lines between WINDOW_SIZE commands, 0 = none
+};
+
+// xoshiro256** seeded through splitmix64: fast, and the same sequence on
+// every platform.
+class Rng {
+ public:
+    explicit Rng(uint64_t seed) {
+        for (uint64_t& w : s_) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            w = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t Next() {
+        uint64_t result = Rotl(s_[1] * 5, 7) * 9;
+        uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = Rotl(s_[3], 45);
+        return result;
+    }
+
+    // [0, 1)
+    double Uniform() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+    // [0, n)
+    uint64_t Below(uint64_t n) { return n ? Next() % n : 0; }
+    bool Chance(double p) { return Uniform() < p; }
+
+ private:
+    static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    uint64_t s_[4];
+};
+
+// Rank r (0-based) with probability proportional to 1 / (r + 1)^s, by binary
+// search over the cumulative weights.
+class ZipfSampler {
+ public:
+    ZipfSampler(size_t n, double s) : cdf_(n) {
+        double sum = 0;
+        for (size_t r = 0; r < n; ++r) {
+            sum += 1.0 / std::pow(static_cast<double>(r + 1), s);
+            cdf_[r] = sum;
+        }
+        for (double& c : cdf_) c /= sum;
+    }
+
+    size_t Sample(Rng& rng) const {
+        double u = rng.Uniform();
+        size_t r = std::upper_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+        return std::min(r, cdf_.size() - 1);
+    }
+
+ private:
+    std::vector<double> cdf_;
+};
+
+// true if every character of word is a CJK ideograph (3-byte UTF-8, U+4E00..U+9FFF)
+bool all_cjk(const std::string& word) {
+    if (word.empty() || word.size() % 3 != 0) return false;
+    for (size_t i = 0; i < word.size(); i += 3) {
+        unsigned char b0 = word[i];
+        if (b0 < 0xE4 || b0 > 0xE9) return false;
+    }
+    return true;
+}
+
+// The `limit` most frequent words of at least two characters, most frequent
+// first (ties by text, so the order does not depend on the file order).
+bool load_vocab(const std::string& path, size_t limit, std::vector<std::string>& words) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+    std::vector<std::pair<long long, std::string>> entries;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t sp = line.find(' ');
+        if (sp == std::string::npos) continue;
+        std::string word = line.substr(0, sp);
+        if (word.size() < 6 || !all_cjk(word)) continue;
+        entries.emplace_back(std::atoll(line.c_str() + sp + 1), word);
+    }
+    std::sort(entries.begin(), entries.end(), [](const std::pair<long long, std::string>& a,
+                                                 const std::pair<long long, std::string>& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    if (entries.size() > limit) entries.resize(limit);
+    words.clear();
+    for (auto& e : entries) words.push_back(std::move(e.second));
+    return !words.empty();
+}
+
+struct Burst {
+    long long begin = 0; // seconds
+    long long end = 0;
+    size_t word = 0;     // vocab index
+};
+
+int usage() {
+    std::cerr << "usage: hotwords_gen [--lines N] [--seed S] [--out FILE] [--dict FILE] [--vocab N] [--zipf S]\n"
+                 "                    [--words MIN MAX] [--spaces] [--bursts N] [--burst-secs N] [--burst-share P]\n"
+                 "                    [--late-rate P] [--late-max SECS] [--query-every N] [--window-every N]" << std::endl;
+    return EXIT_FAILURE;
+}
+
+int parse_args(int argc, char** argv, GenOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--spaces") {
+            opt.spaces = true;
+            continue;
+        }
+        int need = (arg == "--words") ? 2 : 1;
+        if (i + need >= argc) return usage();
+        const char* v = argv[i + 1];
+        if (arg == "--lines") opt.lines = std::atoll(v);
+        else if (arg == "--seed") opt.seed = std::strtoull(v, nullptr, 10);
+        else if (arg == "--out") opt.out = v;
+        else if (arg == "--dict") opt.dict = v;
+        else if (arg == "--vocab") opt.vocab = static_cast<size_t>(std::max(1LL, std::atoll(v)));
+        else if (arg == "--zipf") opt.zipf = std::atof(v);
+        else if (arg == "--words") {
+            opt.min_words = std::max(1, std::atoi(v));
+            opt.max_words = std::max(opt.min_words, std::atoi(argv[i + 2]));
+        }
+        else if (arg == "--bursts") opt.bursts = std::max(0, std::atoi(v));
+        else if (arg == "--burst-secs") opt.burst_secs = std::max(1, std::atoi(v));
+        else if (arg == "--burst-share") opt.burst_share = std::atof(v);
+        else if (arg == "--late-rate") opt.late_rate = std::atof(v);
+        else if (arg == "--late-max") opt.late_max = std::max(1, std::atoi(v));
+        else if (arg == "--query-every") opt.query_every = std::max(0LL, std::atoll(v));
+        else if (arg == "--window-every") opt.window_every = std::max(0LL, std::atoll(v));
+        else return usage();
+        i += need;
+    }
+    return opt.lines > 0 ? EXIT_SUCCESS : usage();
+}
+
+void append_time(std::string& buf, long long t) {
+    char stamp[16];
+    int n = std::snprintf(stamp, sizeof(stamp), "[%02d:%02d:%02d] ", static_cast<int>(t / 3600),
+                          static_cast<int>(t / 60 % 60), static_cast<int>(t % 60));
+    buf.append(stamp, n);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    GenOptions opt;
+    if (parse_args(argc, argv, opt) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    std::vector<std::string> words;
+    if (!load_vocab(opt.dict, opt.vocab, words)) {
+        std::cerr << "[ERROR] no usable words in dictionary: " << opt.dict << std::endl;
+        return EXIT_FAILURE;
+    }
+    Rng rng(opt.seed);
+    ZipfSampler zipf(words.size(), opt.zipf);
+
+    // burst words come from outside the head of the distribution, so that a
+    // burst visibly changes the Top-K
+    std::vector<Burst> bursts(opt.bursts);
+    size_t head = std::min<size_t>(100, words.size() / 2);
+    for (Burst& b : bursts) {
+        b.begin = static_cast<long long>(rng.Below(kDaySeconds));
+        b.end = std::min(kDaySeconds, b.begin + opt.burst_secs);
+        b.word = head + rng.Below(words.size() - head);
+    }
+    std::sort(bursts.begin(), bursts.end(), [](const Burst& a, const Burst& b) { return a.begin < b.begin; });
+
+    FILE* out = opt.out.empty() ? stdout : std::fopen(opt.out.c_str(), "wb");
+    if (out == nullptr) {
+        std::cerr << "[ERROR] cannot open output file: " << opt.out << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    static const char* const kTails[] = {"！", "？", "~", "233", "哈哈哈", "！！！"};
+    std::string buf;
+    buf.reserve(1 << 20);
+    std::vector<size_t> active; // bursts covering the current second
+    size_t next_burst = 0;
+    for (long long i = 0; i < opt.lines; ++i) {
+        long long now = i * kDaySeconds / opt.lines; // lines spread evenly over the day
+
+        if (opt.query_every && i > 0 && i % opt.query_every == 0) {
+            // mostly the current minute (live window), sometimes an earlier one (history)
+            long long minute = now / 60;
+            if (rng.Chance(0.3) && minute > 0) minute = static_cast<long long>(rng.Below(minute));
+            buf += "[ACTION] QUERY K=" + std::to_string(minute) + "\n";
+        }
+        if (opt.window_every && i > 0 && i % opt.window_every == 0) {
+            buf += "[ACTION] WINDOW_SIZE=" + std::to_string(1 + rng.Below(30)) + "\n";
+        }
+
+        while (next_burst < bursts.size() && bursts[next_burst].begin <= now) active.push_back(next_burst++);
+        active.erase(std::remove_if(active.begin(), active.end(), [&](size_t b) { return bursts[b].end <= now; }),
+                     active.end());
+
+        long long t = now;
+        if (rng.Chance(opt.late_rate)) t = std::max(0LL, now - 1 - static_cast<long long>(rng.Below(opt.late_max)));
+        append_time(buf, t);
+
+        int n = opt.min_words + static_cast<int>(rng.Below(opt.max_words - opt.min_words + 1));
+        int burst_pos = -1;
+        size_t burst_word = 0;
+        if (!active.empty() && rng.Chance(opt.burst_share)) {
+            burst_word = bursts[active[rng.Below(active.size())]].word;
+            burst_pos = static_cast<int>(rng.Below(n));
+        }
+        for (int w = 0; w < n; ++w) {
+            if (w > 0 && opt.spaces) buf += ' ';
+            buf += words[w == burst_pos ? burst_word : zipf.Sample(rng)];
+        }
+        if (rng.Chance(0.2)) buf += kTails[rng.Below(sizeof(kTails) / sizeof(kTails[0]))];
+        buf += '\n';
+
+        if (buf.size() >= (1 << 20)) {
+            std::fwrite(buf.data(), 1, buf.size(), out);
+            buf.clear();
+        }
+    }
+    std::fwrite(buf.data(), 1, buf.size(), out);
+    bool ok = std::ferror(out) == 0;
+    if (out != stdout) ok = (std::fclose(out) == 0) && ok;
+    if (!ok) {
+        std::cerr << "[ERROR] write failed: " << (opt.out.empty() ? "stdout" : opt.out) << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
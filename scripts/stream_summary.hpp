@@ -0,0 +1,169 @@
+#pragma once
+// Stream-Summary frequency buckets for the live window.
+// Words with the same count share a bucket and the buckets form a list
+// ordered by count, so +1/-1 on a word moves it to the neighbouring bucket in
+// O(1) and the Top-K is read from the highest bucket down: O(K) plus sorting
+// the ties of the last bucket that is needed. Adding or removing n at once
+// walks at most n buckets.
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "vocab.hpp"
+
+class StreamSummary {
+ public:
+    int Count(WordId id) const {
+        return id < slots_.size() ? slots_[id].count : 0;
+    }
+    size_t Size() const { return size_; }
+
+    // Estimated heap bytes of the slots, buckets and their member lists.
+    size_t MemoryBytes() const {
+        size_t bytes = slots_.capacity() * sizeof(Slot) + buckets_.capacity() * sizeof(Bucket)
+                     + free_.capacity() * sizeof(int);
+        for (const Bucket& b : buckets_) bytes += b.members.capacity() * sizeof(WordId);
+        return bytes;
+    }
+
+    void Increment(WordId id) { Add(id, 1); }
+    void Decrement(WordId id) { Sub(id, 1); }
+
+    void Add(WordId id, int n) {
+        if (n <= 0) return;
+        if (id >= slots_.size()) slots_.resize(id + 1);
+        int from = slots_[id].bucket;
+        int count = slots_[id].count + n;
+        // walk up from the current bucket (from the bottom for a new word)
+        int lower = from;
+        int higher = (from == kNone) ? low_ : buckets_[from].higher;
+        while (higher != kNone && buckets_[higher].count < count) {
+            lower = higher;
+            higher = buckets_[higher].higher;
+        }
+        int to = (higher != kNone && buckets_[higher].count == count) ? higher : NewBucket(count, lower, higher);
+        if (from == kNone) ++size_; else Remove(id, from);
+        Insert(id, to);
+        slots_[id].count = count;
+    }
+
+    // n must not exceed the word's count.
+    void Sub(WordId id, int n) {
+        if (n <= 0) return;
+        int from = slots_[id].bucket;
+        int count = slots_[id].count - n;
+        if (count <= 0) {
+            Remove(id, from);
+            slots_[id] = Slot();
+            --size_;
+            return;
+        }
+        int higher = from;
+        int lower = buckets_[from].lower;
+        while (lower != kNone && buckets_[lower].count > count) {
+            higher = lower;
+            lower = buckets_[lower].lower;
+        }
+        int to = (lower != kNone && buckets_[lower].count == count) ? lower : NewBucket(count, lower, higher);
+        Remove(id, from);
+        Insert(id, to);
+        slots_[id].count = count;
+    }
+
+    void Clear() {
+        for (int b = low_; b != kNone;) {
+            for (WordId id : buckets_[b].members) slots_[id] = Slot();
+            int next = buckets_[b].higher;
+            FreeBucket(b);
+            b = next;
+        }
+        low_ = high_ = kNone;
+        size_ = 0;
+    }
+
+    // The k words with the highest counts. word_less orders words of equal
+    // count; only the bucket that straddles position k is partially sorted.
+    template <class WordLess>
+    void TopK(size_t k, WordLess word_less, std::vector<std::pair<WordId, int>>& res) const {
+        res.clear();
+        for (int b = high_; b != kNone && res.size() < k; b = buckets_[b].lower) {
+            const Bucket& bucket = buckets_[b];
+            size_t begin = res.size();
+            for (WordId id : bucket.members) res.emplace_back(id, bucket.count);
+            auto less = [&](const std::pair<WordId, int>& x, const std::pair<WordId, int>& y) {
+                return word_less(x.first, y.first);
+            };
+            size_t need = std::min(k - begin, bucket.members.size());
+            std::partial_sort(res.begin() + begin, res.begin() + begin + need, res.end(), less);
+            res.resize(begin + need);
+        }
+    }
+
+ private:
+    static constexpr int kNone = -1;
+
+    struct Slot {
+        int count = 0;
+        int bucket = kNone;  // index into buckets_
+        uint32_t pos = 0;    // index in the bucket's members
+    };
+    struct Bucket {
+        int count = 0;
+        int lower = kNone;   // bucket with the next smaller count
+        int higher = kNone;  // bucket with the next larger count
+        std::vector<WordId> members;
+    };
+
+    // Create an empty bucket between `lower` and `higher`.
+    int NewBucket(int count, int lower, int higher) {
+        int b;
+        if (!free_.empty()) {
+            b = free_.back();
+            free_.pop_back();
+        } else {
+            b = static_cast<int>(buckets_.size());
+            buckets_.emplace_back();
+        }
+        Bucket& bucket = buckets_[b];
+        bucket.count = count;
+        bucket.lower = lower;
+        bucket.higher = higher;
+        if (lower != kNone) buckets_[lower].higher = b; else low_ = b;
+        if (higher != kNone) buckets_[higher].lower = b; else high_ = b;
+        return b;
+    }
+
+    // Unlink an empty bucket and keep it (and its capacity) for reuse.
+    void FreeBucket(int b) {
+        Bucket& bucket = buckets_[b];
+        bucket.members.clear();
+        free_.push_back(b);
+    }
+
+    void Insert(WordId id, int b) {
+        Slot& s = slots_[id];
+        s.bucket = b;
+        s.pos = static_cast<uint32_t>(buckets_[b].members.size());
+        buckets_[b].members.push_back(id);
+    }
+
+    void Remove(WordId id, int b) {
+        Bucket& bucket = buckets_[b];
+        uint32_t pos = slots_[id].pos;
+        WordId last = bucket.members.back();
+        bucket.members[pos] = last;
+        slots_[last].pos = pos;
+        bucket.members.pop_back();
+        if (!bucket.members.empty()) return;
+        if (bucket.lower != kNone) buckets_[bucket.lower].higher = bucket.higher; else low_ = bucket.higher;
+        if (bucket.higher != kNone) buckets_[bucket.higher].lower = bucket.lower; else high_ = bucket.lower;
+        FreeBucket(b);
+    }
+
+    std::vector<Slot> slots_;      // per word id
+    std::vector<Bucket> buckets_;
+    std::vector<int> free_;        // unused bucket indices
+    int low_ = kNone;              // lowest count bucket
+    int high_ = kNone;             // highest count bucket
+    size_t size_ = 0;              // words with a nonzero count
+};
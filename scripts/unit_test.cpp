@@ -1,6 +1,8 @@
 // 本脚本做两轮验证：
 // 1) 基线：不启用词性筛选，确认动词等都会进入热词统计；
 // 2) 词性筛选：写入 tag.txt（n/nz），再次跑流程，确认动词被过滤，只保留名词；
+// 另外验证多线程输出一致，敏感短语的 token/mask/drop 三种处理方式，阶段耗时与内存统计，
+// 以及服务模式下的流水线请求；
 // 末尾将单测总结与两轮查询结果追加到 output/output_unit_test.txt，便于对比。
 
 #include <iostream>
@@ -8,28 +10,15 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <thread>
 #include "Jieba.hpp"
+#include "run_modes.hpp" // deal_with_file_input / deal_with_console_input from hotwords_core
+#include "server.hpp"
 #ifdef _WIN32
 #include <windows.h>
 #include <psapi.h>
 #endif
 
-// Local re-declarations to avoid including utils.hpp (which defines non-inline functions)
-// Keep in sync with scripts/utils.hpp
-struct Config {
-    std::string inputFile;
-    std::string outputFile;
-    std::string dictDir;
-    std::string jiebamode;
-    int topk;
-    int time_range;
-    int work_type;
-};
-
-// Forward declarations of functions defined in scripts/main.cpp
-int deal_with_file_input(cppjieba::Jieba& jieba, const Config& cfg);
-int deal_with_console_input(cppjieba::Jieba& jieba, const Config& cfg);
-
 static std::vector<std::string> g_logs; // collect PASS/FAIL lines for appending to output file
 
 static bool expect(bool cond, const std::string& msg) {
@@ -101,7 +90,7 @@ int main() {
     std::string userDict = std::string(JIEBA_DICT_DIR) + "/user.dict.utf8";
     std::string idfFile  = std::string(JIEBA_DICT_DIR) + "/idf.utf8";
     std::string stopFile = std::string(JIEBA_DICT_DIR) + "/stop_words.utf8";
-    cppjieba::Jieba jieba(mainDict, hmmModel, userDict, idfFile, stopFile);
+    cppjieba::Jieba jieba(mainDict, hmmModel, userDict, idfFile, stopFile, &kDictKeyNormalizer);
 
     // Insert user words (e.g., 人工智能) to match app behavior
     // 插入专有名词之后，再进行测试
@@ -220,6 +209,133 @@ int main() {
     }();
     bool case_user_filtered = expect(contains_word(q3_filtered, "中山大学计算机学院"), "用户词可查询：筛选 (含 x) Query@3 包含 中山大学计算机学院");
 
+    // 6) 多线程流水线：input1 在 1 个线程与 4 个线程下的输出应逐行一致（线程数与性能指标除外）
+    auto run_threads = [&](int threads){
+        Config local = cfg;
+        local.inputFile = "input1.txt";
+        local.outputFile = "output_unit_test_mt.txt";
+        local.threads = threads;
+        std::vector<std::string> rows;
+        if (deal_with_file_input(jieba, local) != EXIT_SUCCESS) return rows;
+        for (auto &l : read_lines(std::string(OUTPUT_ROOT_DIR) + "/" + local.outputFile)) {
+            if (l.rfind("Threads:", 0) == 0) continue;
+            if (l.rfind("=====", 0) == 0 && l.find("cppjieba") == std::string::npos) break; // metrics footer
+            rows.push_back(l);
+        }
+        return rows;
+    };
+    auto rows_single = run_threads(1);
+    auto rows_multi = run_threads(4);
+    bool case_mt = expect(!rows_single.empty() && rows_single == rows_multi, "多线程流水线输出与单线程一致 (input1, 4 threads)");
+
+    // 7) 敏感短语自动机：token 模式只过滤恰好切成敏感词的词；mask 在分词前屏蔽句中出现的敏感词，drop 整句丢弃
+    // 输入为仓库中的 input/unit_test_sensitive_input.txt，tag.txt 保持上面写回的 n/nz/x
+    auto run_sensitive = [&](const std::string& mode){
+        Config local = cfg;
+        local.inputFile = "unit_test_sensitive_input.txt";
+        local.outputFile = "output_unit_test_sensitive.txt";
+        local.sensitive_filter = mode;
+        if (deal_with_file_input(jieba, local) != EXIT_SUCCESS) return std::vector<std::string>{};
+        auto rows = read_lines(std::string(OUTPUT_ROOT_DIR) + "/" + local.outputFile);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (rows[i].find("Query Time: 1 minute") != std::string::npos) return collect_top_lines(rows, (int)i);
+        }
+        return std::vector<std::string>{};
+    };
+    auto top_token = run_sensitive("token");
+    auto top_mask = run_sensitive("mask");
+    auto top_drop = run_sensitive("drop");
+    bool case_phrase = expect(contains_word(top_token, "黄金") && !contains_word(top_mask, "黄金") && contains_word(top_mask, "白银") &&
+                              !contains_word(top_drop, "白银") && contains_word(top_drop, "新闻"),
+                              "敏感短语: token 保留 黄金，mask 屏蔽句中的 黄，drop 丢弃整句");
+
+    // 8) 阶段耗时直方图：输出末尾有分阶段表格，<输出文件名>_latency.json 中各分位数单调不减
+    auto json_field = [](const std::string& row, const std::string& key) -> long long {
+        size_t p = row.find("\"" + key + "\": ");
+        return p == std::string::npos ? -1 : std::atoll(row.c_str() + p + key.size() + 4);
+    };
+    bool has_stage_table = false;
+    for (auto &l : read_lines(std::string(OUTPUT_ROOT_DIR) + "/output_unit_test_mt.txt")) {
+        if (l.rfind("StageLatency(ns)", 0) == 0) has_stage_table = true;
+    }
+    bool latency_ok = false;
+    for (auto &row : read_lines(std::string(OUTPUT_ROOT_DIR) + "/output_unit_test_mt_latency.json")) {
+        if (row.find("\"name\": \"line\"") == std::string::npos) continue;
+        long long p50 = json_field(row, "p50"), p99 = json_field(row, "p99"), max = json_field(row, "max");
+        latency_ok = json_field(row, "count") > 0 && p50 > 0 && p50 <= p99 && p99 <= max;
+    }
+    bool case_latency = expect(has_stage_table && latency_ok, "阶段耗时: 输出含分阶段表格，latency.json 的 line 分位数 p50<=p99<=max");
+
+    // 9) 内存统计：输出含峰值内存与各结构的估算；Linux 下 RSS 读自 /proc/self/status，应大于 0
+    double rss_mb = 0.0;
+    bool has_breakdown = false;
+    for (auto &l : read_lines(std::string(OUTPUT_ROOT_DIR) + "/output_unit_test_mt.txt")) {
+        if (l.rfind("Memory(MB): ", 0) == 0) rss_mb = std::atof(l.c_str() + 12);
+        if (l.rfind("  history ", 0) == 0) has_breakdown = true;
+    }
+#ifdef __linux__
+    bool rss_ok = rss_mb > 0.0;
+#else
+    bool rss_ok = true;
+#endif
+    bool case_memory = expect(rss_ok && has_breakdown, "内存统计: Memory(MB) 非 0 (Linux)，并列出各结构的估算");
+
+    // 10) 服务模式：一次发送多条请求 (流水线)，响应按请求顺序返回；第二个连接发送 SHUTDOWN 停止服务
+    auto run_server = [&](const std::string& spec) -> bool {
+        HotWordsEngine engine(jieba, cfg);
+        engine.SetAllowedTags({}); // 不依赖 tag.txt 的内容
+        HotWordsServer server(engine);
+        if (!server.Listen(spec)) {
+            std::cerr << "cannot listen on " << spec << ": " << server.error() << std::endl;
+            return false;
+        }
+        std::thread serving([&]{ server.Run(); });
+        HotWordsClient client;
+        bool ok = client.Connect(server.address());
+        ok = ok && client.Send("INGEST 4\n"
+                               "[00:01:00] 人工智能 人工智能 大学\n"
+                               "[00:01:30] 大学\n"
+                               "没有时间的行\n"
+                               "[ACTION] QUERY K=1\n"
+                               "QUERY 1 1\n"
+                               "WINDOW_SIZE 3\n"
+                               "STATS\n"
+                               "BOGUS\n"
+                               "WINDOW_SIZE 4294967296\n"
+                               "QUERY 1440\n"
+                               "QUIT\n");
+        std::string header;
+        std::vector<std::string> body;
+        ok = ok && client.ReadResponse(header, body) && header.rfind("OK ", 0) == 0 &&
+             header.find("lines=4 skipped=1") != std::string::npos && contains_word(body, "人工智能") &&
+             !body.empty() && body[0].find("Line 3") != std::string::npos;
+        ok = ok && client.ReadResponse(header, body) && header == "OK 1 minute=1 time_range=2" &&
+             body[0].rfind("1: 人工智能/", 0) == 0 && body[0].find("/2") != std::string::npos;
+        ok = ok && client.ReadResponse(header, body) && header == "OK 0 time_range=3";
+        bool has_stats = false;
+        ok = ok && client.ReadResponse(header, body);
+        for (auto &l : body) has_stats = has_stats || l.rfind("StageLatency(ns)", 0) == 0;
+        ok = ok && has_stats && body[0] == "lines: 4";
+        ok = ok && client.ReadResponse(header, body) && header.rfind("ERR ", 0) == 0;
+        // 超出一天范围的窗口与分钟被拒绝，窗口保持不变 (服务停止后检查)
+        ok = ok && client.ReadResponse(header, body) && header.rfind("ERR ", 0) == 0;
+        ok = ok && client.ReadResponse(header, body) && header.rfind("ERR ", 0) == 0;
+        ok = ok && client.ReadResponse(header, body) && header == "OK 0";
+        ok = ok && !client.ReadResponse(header, body); // QUIT 之后连接被关闭
+
+        HotWordsClient admin;
+        bool stopped = admin.Connect(server.address()) && admin.Send("SHUTDOWN\n") &&
+                       admin.ReadResponse(header, body) && header == "OK 0";
+        if (!stopped) server.Stop();
+        serving.join();
+        return ok && stopped && server.requests() == 9 && engine.counter().time_range() == 3;
+    };
+    bool server_ok = run_server("tcp:127.0.0.1:0");
+#ifndef _WIN32
+    server_ok = run_server("unix:/tmp/hotwords_unit_test.sock") && server_ok;
+#endif
+    bool case_server = expect(server_ok, "服务模式: 流水线请求 INGEST/QUERY/WINDOW_SIZE/STATS/ERR/QUIT 按序响应，越界参数返回 ERR，SHUTDOWN 停止服务");
+
     auto append_logs = [&](bool all_ok){
         std::ofstream ofs(std::string(OUTPUT_ROOT_DIR) + "/" + cfg.outputFile, std::ios::binary | std::ios::app);
         if (!ofs.is_open()) return;
@@ -236,7 +352,7 @@ int main() {
         for (auto &l : q3_filtered) ofs << l << "\n";
     };
 
-    if (!(case1 && case1b && case2 && case4b && case4a && case_pos_diff && case_user && case_user_filtered)) {
+    if (!(case1 && case1b && case2 && case4b && case4a && case_pos_diff && case_user && case_user_filtered && case_mt && case_phrase && case_latency && case_memory && case_server)) {
         std::cerr << "\nSome tests FAILED." << std::endl;
         append_logs(false);
         return 1;
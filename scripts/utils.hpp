@@ -14,7 +14,12 @@
 #include<unordered_map>
 #include<unordered_set>
 #include<stdlib.h>
-#include "utf8.h"
+#include "normalizer.hpp"
+#include "normalize.hpp"
+
+// Dictionary keys are folded with the same rules as the input sentences
+// (normalize_text); pass to every Jieba / DictTrie the app builds.
+const cppjieba::DictTrie::KeyNormalizer kDictKeyNormalizer = {"normalize_text/1", normalize_text};
 #include <stdexcept> // 需要引入异常头文件
 #ifdef _WIN32
 #include <windows.h>
@@ -23,24 +28,6 @@
 
 typedef long long ll;
 
-void normalize_radicals(std::string& s) {
-    std::u32string u32;
-
-    // UTF-8 -> UTF-32
-    utf8::utf8to32(s.begin(), s.end(), std::back_inserter(u32));
-
-    for (auto& ch : u32) {
-        if (ch == 0x2F08) ch = 0x4EBA; // ⼈ -> 人
-        if (ch == 0x2F2F) ch = 0x5DE5; // ⼯ -> 工
-    }
-
-    // UTF-32 -> UTF-8
-    std::string result;
-    utf8::utf32to8(u32.begin(), u32.end(), std::back_inserter(result));
-
-    s.swap(result);
-}
-
 struct Config {
     std::string inputFile;
     std::string outputFile;
@@ -49,9 +36,13 @@ struct Config {
     int topk;
     int time_range;
     int work_type;
+    int threads = 0; // file mode worker threads, 0 = one per hardware thread
+    bool normalize = true; // sanitize invalid UTF-8 / BOM and NFC normalize input lines
+    std::string sensitive_filter = "token"; // token | mask | drop
+    std::string server_listen = "tcp:127.0.0.1:7070"; // work_type 3: tcp:<host>:<port> or unix:<path>
 };
 
-bool ReadUtf8Lines(const std::string& filename, std::vector<std::string>& lines) {
+inline bool ReadUtf8Lines(const std::string& filename, std::vector<std::string>& lines) {
     std::ifstream ifs(filename, std::ios::binary);
     if (!ifs.is_open()) {
         return false;
@@ -71,7 +62,7 @@ bool ReadUtf8Lines(const std::string& filename, std::vector<std::string>& lines)
 
 
 //using "/" to split words
-std::string Join(const std::vector<std::string>& items, const std::string& delim) {
+inline std::string Join(const std::vector<std::string>& items, const std::string& delim) {
     std::ostringstream oss;
     for (size_t i = 0; i < items.size(); ++i) {
         if (i) oss << delim;
@@ -82,14 +73,14 @@ std::string Join(const std::vector<std::string>& items, const std::string& delim
 
 
 //removing the spaces/tabs/newlines at head and tail
-std::string Trim(const std::string& s) {
+inline std::string Trim(const std::string& s) {
     size_t b = s.find_first_not_of(" \t\r\n");
     if (b == std::string::npos) return "";
     size_t e = s.find_last_not_of(" \t\r\n");
     return s.substr(b, e - b + 1);
 }
 
-bool LoadIni(const std::string& path, Config& cfg) {
+inline bool LoadIni(const std::string& path, Config& cfg) {
     std::ifstream in(path, std::ios::binary);
     if (!in.is_open()) return false;
     std::string line;
@@ -108,11 +99,15 @@ bool LoadIni(const std::string& path, Config& cfg) {
         else if (key == "topk") cfg.topk = std::atoi(val.c_str());//atoi: string->int
         else if (key == "time_range") cfg.time_range = std::atoi(val.c_str());
         else if (key == "work_type") cfg.work_type = std::atoi(val.c_str());
+        else if (key == "threads") cfg.threads = std::atoi(val.c_str());
+        else if (key == "normalize") cfg.normalize = (val == "true" || val == "1");
+        else if (key == "sensitive_filter") cfg.sensitive_filter = val;
+        else if (key == "server_listen") cfg.server_listen = val;
     }
     return true;
 }
 
-std::string extractAction(const std::string& sentence){
+inline std::string extractAction(const std::string& sentence){
     size_t start = sentence.find('[');
     if (start == std::string::npos) return "";
     size_t end = sentence.find(']', start);
@@ -120,13 +115,13 @@ std::string extractAction(const std::string& sentence){
     return sentence.substr(start + 1, end - start - 1);
 }
 
-std::string extractSentence(const std::string& sentence){
+inline std::string extractSentence(const std::string& sentence){
     size_t start = sentence.find(']');
     if(start == std::string::npos) return sentence;
     else return Trim(sentence.substr(start+1));
 }
 
-bool checkTime(const std::string& time_str, int &h, int &m, int &s) {
+inline bool checkTime(const std::string& time_str, int &h, int &m, int &s) {
     if (time_str.empty()) return false;
     if (std::sscanf(time_str.c_str(), "%d:%d:%d", &h, &m, &s) == 3) {
         //加上范围检查
@@ -137,7 +132,7 @@ bool checkTime(const std::string& time_str, int &h, int &m, int &s) {
     return false;
 }
 
-long long check_start_time(const std::string& s) {
+inline long long check_start_time(const std::string& s) {
     size_t pos = s.find("K=");
     if (pos == std::string::npos) return -1;
 
@@ -147,10 +142,14 @@ long long check_start_time(const std::string& s) {
 
     if (end == pos) return -1; // no digits
 
-    return std::stoll(s.substr(pos, end - pos));//stoll: string->long long
+    try {
+        return std::stoll(s.substr(pos, end - pos));//stoll: string->long long
+    } catch (...) {
+        return -1; // too large for long long
+    }
 }
 
-void scan_stop_words(std::unordered_set<std::string>& stop_words_set){
+inline void scan_stop_words(std::unordered_set<std::string>& stop_words_set){
     // scan for stop words
     std::vector<std::string> stopword_lines;
     std::string stopwordpath = std::string(JIEBA_DICT_DIR) + "/stop_words.utf8";
@@ -159,23 +158,25 @@ void scan_stop_words(std::unordered_set<std::string>& stop_words_set){
         return ;
     } else {
         for (auto& word : stopword_lines) {
+            normalize_text(word); // must match normalized input
             stop_words_set.insert(word);
         }
     }
 }
 
-void scan_sensitive_words(std::unordered_set<std::string>& stop_words_set){
+inline void scan_sensitive_words(std::unordered_set<std::string>& stop_words_set){
     // sensitive words eliminate
     std::string sensitive_words_path = std::string(INPUT_ROOT_DIR) + "/sensitive_words.txt";
     std::vector<std::string> sensitive_vec;
     if (ReadUtf8Lines(sensitive_words_path, sensitive_vec)) {
         for (auto& word : sensitive_vec) {
+            normalize_text(word);
             stop_words_set.insert(word);
         }
     }
 }
 
-void scan_tag_allowed(std::unordered_set<std::string>& tag_allowed_set){
+inline void scan_tag_allowed(std::unordered_set<std::string>& tag_allowed_set){
     // tag allowed scan
     std::string tag_allowed_path = std::string(INPUT_ROOT_DIR) + "/tag.txt";
     std::vector<std::string> tag_allowed_vec;
@@ -187,7 +188,7 @@ void scan_tag_allowed(std::unordered_set<std::string>& tag_allowed_set){
 }
 
 // Parse window size command like: "WINDOW_SIZE = 10"; return minutes or -1 if absent/invalid
-long long check_window_size(const std::string& s) {
+inline long long check_window_size(const std::string& s) {
     std::string t = s;
     // Normalize spaces
     // Look for keyword
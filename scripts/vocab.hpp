@@ -0,0 +1,100 @@
+#pragma once
+// Vocabulary interner: every distinct token gets a dense uint32_t id, so the
+// counting structures store and hash 4-byte ids instead of std::string copies.
+// The word text and its tag are kept once, in the vocab entry.
+//
+// Each entry also carries filter flags, resolved once when the word is
+// interned, so dropping stop words and disallowed tags costs a load and an
+// AND per token instead of string hash lookups.
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "DictTrie.hpp"
+
+typedef uint32_t WordId;
+
+enum : uint8_t {
+    kWordStop = 1,       // stop word or sensitive word
+    kWordTagDenied = 2,  // tag not in the allowed tag list
+};
+
+struct VocabEntry {
+    std::string word;
+    cppjieba::TagId tag_id = cppjieba::TAG_ID_UNKNOWN;
+    uint8_t flags = 0;
+};
+
+class Vocab {
+ public:
+    static constexpr WordId kNoWord = UINT32_MAX;
+
+    Vocab() = default;
+    Vocab(const Vocab&) = delete;
+    Vocab& operator=(const Vocab&) = delete;
+
+    // Id of word, adding it on first sight. A word's tag never changes (the
+    // tagger derives it from the word alone), so it is only recorded once.
+    WordId Intern(std::string_view word, cppjieba::TagId tag_id) {
+        auto it = index_.find(word);
+        if (it != index_.end()) return it->second;
+        WordId id = static_cast<WordId>(entries_.size());
+        entries_.emplace_back();
+        entries_.back().word.assign(word.data(), word.size());
+        entries_.back().tag_id = tag_id;
+        entries_.back().flags = TagAllowed(tag_id) ? 0 : kWordTagDenied;
+        // deque never moves its elements, so the key can view the entry's string
+        index_.emplace(std::string_view(entries_.back().word), id);
+        return id;
+    }
+
+    WordId Find(std::string_view word) const {
+        auto it = index_.find(word);
+        return it == index_.end() ? kNoWord : it->second;
+    }
+
+    const std::string& Word(WordId id) const { return entries_[id].word; }
+    cppjieba::TagId Tag(WordId id) const { return entries_[id].tag_id; }
+    uint8_t Flags(WordId id) const { return entries_[id].flags; }
+    // true if the word is not to be counted
+    bool Filtered(WordId id) const { return entries_[id].flags != 0; }
+    size_t Size() const { return entries_.size(); }
+
+    // Estimated heap bytes: entries, word text past the SSO buffer, the index.
+    size_t MemoryBytes() const {
+        size_t bytes = entries_.size() * sizeof(VocabEntry) + allowed_tags_.capacity();
+        for (const VocabEntry& e : entries_) {
+            if (e.word.capacity() > 15) bytes += e.word.capacity() + 1;
+        }
+        bytes += index_.bucket_count() * sizeof(void*)
+               + index_.size() * (sizeof(std::pair<std::string_view, WordId>) + 2 * sizeof(void*));
+        return bytes;
+    }
+
+    // Only tags with allowed[tag_id] != 0 are counted; ids past the end are
+    // not. An empty table allows every tag. Words interned before are flagged
+    // again; tokens already counted stay counted.
+    void SetAllowedTags(std::vector<uint8_t> allowed) {
+        allowed_tags_ = std::move(allowed);
+        for (VocabEntry& e : entries_) {
+            e.flags = static_cast<uint8_t>((e.flags & ~kWordTagDenied) | (TagAllowed(e.tag_id) ? 0 : kWordTagDenied));
+        }
+    }
+
+    // Never count word.
+    void AddStopWord(std::string_view word) {
+        entries_[Intern(word, cppjieba::TAG_ID_UNKNOWN)].flags |= kWordStop;
+    }
+
+ private:
+    bool TagAllowed(cppjieba::TagId tag_id) const {
+        return allowed_tags_.empty() || (tag_id < allowed_tags_.size() && allowed_tags_[tag_id]);
+    }
+
+    std::deque<VocabEntry> entries_;
+    std::unordered_map<std::string_view, WordId> index_;
+    std::vector<uint8_t> allowed_tags_; // by tag id, empty = all
+};
@@ -1,38 +1,191 @@
 #include "normalize.hpp"
-#include <vector>
+#include <algorithm>
+#include <cstdint>
 #include <iterator>
-#include <fstream>
 
-#include "utfcpp/source/utf8.h"
+#include "utf8.h"
 
-#if __has_include("uni-algo/norm.h")
+#if __has_include("uni_algo/norm.h")
 #define HAS_UNI_ALGO 1
 #include "uni_algo/norm.h"
 #endif
 
-static std::string sanitize_utf8(const std::string& raw) {
-    std::string out;
-    out.reserve(raw.size());
-    utf8::replace_invalid(raw.begin(), raw.end(), std::back_inserter(out));
-    if (out.size() >= 3 &&
-        static_cast<unsigned char>(out[0]) == 0xEF &&
-        static_cast<unsigned char>(out[1]) == 0xBB &&
-        static_cast<unsigned char>(out[2]) == 0xBF) {
-        out.erase(0, 3);
+namespace {
+
+struct CodePointRange {
+    uint32_t first;
+    uint32_t last; // inclusive
+};
+
+// Code points after which a line may not be in NFC: NFC_Quick_Check No or
+// Maybe, or a nonzero canonical combining class (marks that reordering could
+// move). A superset of what a full quick check rejects, so the rare line with
+// combining marks is simply normalized. Generated from Unicode 14.0.
+const CodePointRange kNfcUnsure[] = {
+    {0x0300, 0x034E}, {0x0350, 0x036F}, {0x0374, 0x0374}, {0x037E, 0x037E},
+    {0x0387, 0x0387}, {0x0483, 0x0487}, {0x0591, 0x05BD}, {0x05BF, 0x05BF},
+    {0x05C1, 0x05C2}, {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A},
+    {0x064B, 0x065F}, {0x0670, 0x0670}, {0x06D6, 0x06DC}, {0x06DF, 0x06E4},
+    {0x06E7, 0x06E8}, {0x06EA, 0x06ED}, {0x0711, 0x0711}, {0x0730, 0x074A},
+    {0x07EB, 0x07F3}, {0x07FD, 0x07FD}, {0x0816, 0x0819}, {0x081B, 0x0823},
+    {0x0825, 0x0827}, {0x0829, 0x082D}, {0x0859, 0x085B}, {0x0898, 0x089F},
+    {0x08CA, 0x08E1}, {0x08E3, 0x08FF}, {0x093C, 0x093C}, {0x094D, 0x094D},
+    {0x0951, 0x0954}, {0x0958, 0x095F}, {0x09BC, 0x09BC}, {0x09BE, 0x09BE},
+    {0x09CD, 0x09CD}, {0x09D7, 0x09D7}, {0x09DC, 0x09DD}, {0x09DF, 0x09DF},
+    {0x09FE, 0x09FE}, {0x0A33, 0x0A33}, {0x0A36, 0x0A36}, {0x0A3C, 0x0A3C},
+    {0x0A4D, 0x0A4D}, {0x0A59, 0x0A5B}, {0x0A5E, 0x0A5E}, {0x0ABC, 0x0ABC},
+    {0x0ACD, 0x0ACD}, {0x0B3C, 0x0B3C}, {0x0B3E, 0x0B3E}, {0x0B4D, 0x0B4D},
+    {0x0B56, 0x0B57}, {0x0B5C, 0x0B5D}, {0x0BBE, 0x0BBE}, {0x0BCD, 0x0BCD},
+    {0x0BD7, 0x0BD7}, {0x0C3C, 0x0C3C}, {0x0C4D, 0x0C4D}, {0x0C55, 0x0C56},
+    {0x0CBC, 0x0CBC}, {0x0CC2, 0x0CC2}, {0x0CCD, 0x0CCD}, {0x0CD5, 0x0CD6},
+    {0x0D3B, 0x0D3C}, {0x0D3E, 0x0D3E}, {0x0D4D, 0x0D4D}, {0x0D57, 0x0D57},
+    {0x0DCA, 0x0DCA}, {0x0DCF, 0x0DCF}, {0x0DDF, 0x0DDF}, {0x0E38, 0x0E3A},
+    {0x0E48, 0x0E4B}, {0x0EB8, 0x0EBA}, {0x0EC8, 0x0ECB}, {0x0F18, 0x0F19},
+    {0x0F35, 0x0F35}, {0x0F37, 0x0F37}, {0x0F39, 0x0F39}, {0x0F43, 0x0F43},
+    {0x0F4D, 0x0F4D}, {0x0F52, 0x0F52}, {0x0F57, 0x0F57}, {0x0F5C, 0x0F5C},
+    {0x0F69, 0x0F69}, {0x0F71, 0x0F76}, {0x0F78, 0x0F78}, {0x0F7A, 0x0F7D},
+    {0x0F80, 0x0F84}, {0x0F86, 0x0F87}, {0x0F93, 0x0F93}, {0x0F9D, 0x0F9D},
+    {0x0FA2, 0x0FA2}, {0x0FA7, 0x0FA7}, {0x0FAC, 0x0FAC}, {0x0FB9, 0x0FB9},
+    {0x0FC6, 0x0FC6}, {0x102E, 0x102E}, {0x1037, 0x1037}, {0x1039, 0x103A},
+    {0x108D, 0x108D}, {0x1161, 0x1175}, {0x11A8, 0x11C2}, {0x135D, 0x135F},
+    {0x1714, 0x1715}, {0x1734, 0x1734}, {0x17D2, 0x17D2}, {0x17DD, 0x17DD},
+    {0x18A9, 0x18A9}, {0x1939, 0x193B}, {0x1A17, 0x1A18}, {0x1A60, 0x1A60},
+    {0x1A75, 0x1A7C}, {0x1A7F, 0x1A7F}, {0x1AB0, 0x1ABD}, {0x1ABF, 0x1ACE},
+    {0x1B34, 0x1B35}, {0x1B44, 0x1B44}, {0x1B6B, 0x1B73}, {0x1BAA, 0x1BAB},
+    {0x1BE6, 0x1BE6}, {0x1BF2, 0x1BF3}, {0x1C37, 0x1C37}, {0x1CD0, 0x1CD2},
+    {0x1CD4, 0x1CE0}, {0x1CE2, 0x1CE8}, {0x1CED, 0x1CED}, {0x1CF4, 0x1CF4},
+    {0x1CF8, 0x1CF9}, {0x1DC0, 0x1DFF}, {0x1F71, 0x1F71}, {0x1F73, 0x1F73},
+    {0x1F75, 0x1F75}, {0x1F77, 0x1F77}, {0x1F79, 0x1F79}, {0x1F7B, 0x1F7B},
+    {0x1F7D, 0x1F7D}, {0x1FBB, 0x1FBB}, {0x1FBE, 0x1FBE}, {0x1FC9, 0x1FC9},
+    {0x1FCB, 0x1FCB}, {0x1FD3, 0x1FD3}, {0x1FDB, 0x1FDB}, {0x1FE3, 0x1FE3},
+    {0x1FEB, 0x1FEB}, {0x1FEE, 0x1FEF}, {0x1FF9, 0x1FF9}, {0x1FFB, 0x1FFB},
+    {0x1FFD, 0x1FFD}, {0x2000, 0x2001}, {0x20D0, 0x20DC}, {0x20E1, 0x20E1},
+    {0x20E5, 0x20F0}, {0x2126, 0x2126}, {0x212A, 0x212B}, {0x2329, 0x232A},
+    {0x2ADC, 0x2ADC}, {0x2CEF, 0x2CF1}, {0x2D7F, 0x2D7F}, {0x2DE0, 0x2DFF},
+    {0x302A, 0x302F}, {0x3099, 0x309A}, {0xA66F, 0xA66F}, {0xA674, 0xA67D},
+    {0xA69E, 0xA69F}, {0xA6F0, 0xA6F1}, {0xA806, 0xA806}, {0xA82C, 0xA82C},
+    {0xA8C4, 0xA8C4}, {0xA8E0, 0xA8F1}, {0xA92B, 0xA92D}, {0xA953, 0xA953},
+    {0xA9B3, 0xA9B3}, {0xA9C0, 0xA9C0}, {0xAAB0, 0xAAB0}, {0xAAB2, 0xAAB4},
+    {0xAAB7, 0xAAB8}, {0xAABE, 0xAABF}, {0xAAC1, 0xAAC1}, {0xAAF6, 0xAAF6},
+    {0xABED, 0xABED}, {0xF900, 0xFA0D}, {0xFA10, 0xFA10}, {0xFA12, 0xFA12},
+    {0xFA15, 0xFA1E}, {0xFA20, 0xFA20}, {0xFA22, 0xFA22}, {0xFA25, 0xFA26},
+    {0xFA2A, 0xFA6D}, {0xFA70, 0xFAD9}, {0xFB1D, 0xFB1F}, {0xFB2A, 0xFB36},
+    {0xFB38, 0xFB3C}, {0xFB3E, 0xFB3E}, {0xFB40, 0xFB41}, {0xFB43, 0xFB44},
+    {0xFB46, 0xFB4E}, {0xFE20, 0xFE2F}, {0x101FD, 0x101FD}, {0x102E0, 0x102E0},
+    {0x10376, 0x1037A}, {0x10A0D, 0x10A0D}, {0x10A0F, 0x10A0F}, {0x10A38, 0x10A3A},
+    {0x10A3F, 0x10A3F}, {0x10AE5, 0x10AE6}, {0x10D24, 0x10D27}, {0x10EAB, 0x10EAC},
+    {0x10F46, 0x10F50}, {0x10F82, 0x10F85}, {0x11046, 0x11046}, {0x11070, 0x11070},
+    {0x1107F, 0x1107F}, {0x110B9, 0x110BA}, {0x11100, 0x11102}, {0x11127, 0x11127},
+    {0x11133, 0x11134}, {0x11173, 0x11173}, {0x111C0, 0x111C0}, {0x111CA, 0x111CA},
+    {0x11235, 0x11236}, {0x112E9, 0x112EA}, {0x1133B, 0x1133C}, {0x1133E, 0x1133E},
+    {0x1134D, 0x1134D}, {0x11357, 0x11357}, {0x11366, 0x1136C}, {0x11370, 0x11374},
+    {0x11442, 0x11442}, {0x11446, 0x11446}, {0x1145E, 0x1145E}, {0x114B0, 0x114B0},
+    {0x114BA, 0x114BA}, {0x114BD, 0x114BD}, {0x114C2, 0x114C3}, {0x115AF, 0x115AF},
+    {0x115BF, 0x115C0}, {0x1163F, 0x1163F}, {0x116B6, 0x116B7}, {0x1172B, 0x1172B},
+    {0x11839, 0x1183A}, {0x11930, 0x11930}, {0x1193D, 0x1193E}, {0x11943, 0x11943},
+    {0x119E0, 0x119E0}, {0x11A34, 0x11A34}, {0x11A47, 0x11A47}, {0x11A99, 0x11A99},
+    {0x11C3F, 0x11C3F}, {0x11D42, 0x11D42}, {0x11D44, 0x11D45}, {0x11D97, 0x11D97},
+    {0x16AF0, 0x16AF4}, {0x16B30, 0x16B36}, {0x16FF0, 0x16FF1}, {0x1BC9E, 0x1BC9E},
+    {0x1D15E, 0x1D169}, {0x1D16D, 0x1D172}, {0x1D17B, 0x1D182}, {0x1D185, 0x1D18B},
+    {0x1D1AA, 0x1D1AD}, {0x1D1BB, 0x1D1C0}, {0x1D242, 0x1D244}, {0x1E000, 0x1E006},
+    {0x1E008, 0x1E018}, {0x1E01B, 0x1E021}, {0x1E023, 0x1E024}, {0x1E026, 0x1E02A},
+    {0x1E130, 0x1E136}, {0x1E2AE, 0x1E2AE}, {0x1E2EC, 0x1E2EF}, {0x1E8D0, 0x1E8D6},
+    {0x1E944, 0x1E94A}, {0x2F800, 0x2FA1D},
+};
+
+bool IsNfcUnsure(uint32_t cp) {
+    if (cp < kNfcUnsure[0].first) return false;
+    const CodePointRange* end = kNfcUnsure + sizeof(kNfcUnsure) / sizeof(kNfcUnsure[0]);
+    const CodePointRange* it = std::upper_bound(kNfcUnsure, end, cp,
+        [](uint32_t c, const CodePointRange& r) { return c < r.first; });
+    return (it - 1)->last >= cp;
+}
+
+// Length of the well-formed UTF-8 sequence at s[i] (no overlongs, surrogates
+// or code points above U+10FFFF) and its code point; 0 if ill-formed.
+size_t DecodeWellFormed(const std::string& s, size_t i, uint32_t& cp) {
+    const size_t n = s.size() - i;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data() + i);
+    unsigned char c = p[0];
+    if (c >= 0xC2 && c <= 0xDF) {
+        if (n < 2 || (p[1] & 0xC0) != 0x80) return 0;
+        cp = ((c & 0x1Fu) << 6) | (p[1] & 0x3Fu);
+        return 2;
     }
-    return out;
+    if (c >= 0xE0 && c <= 0xEF) {
+        if (n < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80) return 0;
+        cp = ((c & 0x0Fu) << 12) | ((p[1] & 0x3Fu) << 6) | (p[2] & 0x3Fu);
+        if (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF)) return 0;
+        return 3;
+    }
+    if (c >= 0xF0 && c <= 0xF4) {
+        if (n < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80) return 0;
+        cp = ((c & 0x07u) << 18) | ((p[1] & 0x3Fu) << 12) | ((p[2] & 0x3Fu) << 6) | (p[3] & 0x3Fu);
+        if (cp < 0x10000 || cp > 0x10FFFF) return 0;
+        return 4;
+    }
+    return 0;
 }
 
-std::string normalize_utf8_nfc(const std::string& input) {
-    std::string clean = sanitize_utf8(input);
+enum class QuickCheck { kYes, kMaybe, kInvalid };
+
+// One pass, no allocation: kYes means s is valid UTF-8 and already NFC.
+QuickCheck NfcQuickCheck(const std::string& s) {
+    QuickCheck res = QuickCheck::kYes;
+    size_t i = 0;
+    while (i < s.size()) {
+        if (static_cast<unsigned char>(s[i]) < 0x80) {
+            ++i;
+            continue;
+        }
+        uint32_t cp = 0;
+        size_t len = DecodeWellFormed(s, i, cp);
+        if (len == 0) return QuickCheck::kInvalid;
+        if (IsNfcUnsure(cp)) res = QuickCheck::kMaybe;
+        i += len;
+    }
+    return res;
+}
+
+bool HasBom(const std::string& s) {
+    return s.size() >= 3 &&
+           static_cast<unsigned char>(s[0]) == 0xEF &&
+           static_cast<unsigned char>(s[1]) == 0xBB &&
+           static_cast<unsigned char>(s[2]) == 0xBF;
+}
+
+} // namespace
+
+bool normalize_utf8_nfc_in_place(std::string& s) {
+    bool changed = false;
+    if (HasBom(s)) {
+        s.erase(0, 3);
+        changed = true;
+    }
+    QuickCheck qc = NfcQuickCheck(s);
+    if (qc == QuickCheck::kYes) return changed;
+    if (qc == QuickCheck::kInvalid) {
+        std::string out;
+        out.reserve(s.size() + 8);
+        utf8::replace_invalid(s.begin(), s.end(), std::back_inserter(out));
+        s.swap(out);
+        changed = true;
+        qc = NfcQuickCheck(s);
+    }
 #ifdef HAS_UNI_ALGO
-    std::u32string u32;
-    utf8::utf8to32(clean.begin(), clean.end(), std::back_inserter(u32));
-    auto nfc32 = una::norm::to_nfc(u32);
-    std::string out;
-    utf8::utf32to8(nfc32.begin(), nfc32.end(), std::back_inserter(out));
-    return out;
-#else
-    return clean;
+    if (qc == QuickCheck::kMaybe) {
+        std::string nfc = una::norm::to_nfc_utf8(s);
+        if (nfc != s) {
+            s.swap(nfc);
+            changed = true;
+        }
+    }
 #endif
+    return changed;
+}
+
+std::string normalize_utf8_nfc(const std::string& input) {
+    std::string out = input;
+    normalize_utf8_nfc_in_place(out);
+    return out;
 }
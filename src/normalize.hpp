@@ -3,7 +3,15 @@
 
 // Normalize and sanitize text:
 // - Fix invalid UTF-8 sequences and strip BOM
-// - Optionally normalize to NFC/NFKC if uni-algo is available
+// - Optionally normalize to NFC if uni-algo is available
+//
+// A quick check runs first: a line that is valid UTF-8 and already in NFC
+// (nearly every line) is left as is, without copying or allocating. Only
+// lines that fail it are repaired and/or normalized.
+
+// In place. Returns true if s changed. If NFC is not available, only
+// sanitizes.
+bool normalize_utf8_nfc_in_place(std::string& s);
 
 // Returns valid UTF-8. If NFC is not available, returns sanitized input.
 std::string normalize_utf8_nfc(const std::string& input);
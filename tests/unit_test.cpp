@@ -7,110 +7,15 @@
 3) 敏感词过滤验证：确认敏感词（黄/赌/毒）不会出现在统计结果中；
 4) 动态窗口调整验证：调整窗口大小后，确认查询结果符合预期，原本不应出现的词汇会因为窗口的调节出现。
 5) 用户词典验证：确认用户自定义词典中的词汇能够被正确识别和统计。我们插入“中山大学计算机学院”这样的专有名词，测试能否查出
+6) 文本归一验证：大小写、全角字母与康熙部首按同一规则归一，含大写字母的词典词（T恤）对全角、半角输入都能匹配。
+以上均直接调用 hotwords_core 中的 HotWordsEngine（逐行/批量写入与查询接口），与文件、终端模式使用同一份实现。
 */
 #include <iostream>
 #include <vector>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
-#include <map>
-#include <queue>
-#include <algorithm>
+#include <cstdio>
 #include "Jieba.hpp"
-#include "../scripts/utils.hpp"
-
-struct HotWordsEngine {
-    std::unordered_map<std::string, int> word_count_map;
-    std::unordered_map<std::string, std::string> word_tag_map;
-    std::multimap<ll, std::string> window_index; // time -> word (ordered)
-    std::multimap<ll, std::string> history_map;  // time -> word (ordered)
-    std::unordered_set<std::string> stop_words_set;
-    std::unordered_set<std::string> tag_allowed_set; // empty means allow all
-    int current_time_range_minutes = 2; // default
-    ll currtime = 0; // latest processed event time (seconds)
-
-    void init_filters() {
-        scan_stop_words(stop_words_set);
-        scan_sensitive_words(stop_words_set);
-        // Note: POS filtering via tag_allowed_set is controlled by tests directly
-    }
-
-    void set_allowed_tags(const std::vector<std::string>& tags) {
-        tag_allowed_set.clear();
-        for (const auto& t : tags) tag_allowed_set.insert(t);
-    }
-
-    void set_window_size(int minutes) {
-        if (minutes <= 0) minutes = 1;
-        current_time_range_minutes = minutes;
-        // rebuild current window from history_map for time [currtime - win, currtime]
-        word_count_map.clear();
-        window_index.clear();
-        ll start_time = (currtime >= current_time_range_minutes * 60) ? (currtime - current_time_range_minutes * 60) : 0;
-        auto it_start = history_map.lower_bound(start_time);
-        auto it_end = history_map.upper_bound(currtime);
-        for (auto it = it_start; it != it_end; ++it) {
-            const std::string &w = it->second;
-            word_count_map[w]++;
-            window_index.insert({it->first, w});
-        }
-    }
-
-    void process_line(cppjieba::Jieba& jieba, int h, int m, int s, const std::string& sentence) {
-        ll t = h * 3600 + m * 60 + s;
-        if (t >= currtime) currtime = t;
-        std::vector<std::pair<std::string, std::string>> tagres;
-        std::string sent = sentence;
-        normalize_radicals(sent);
-        jieba.Tag(sent, tagres);
-
-        for (auto &v : tagres) {
-            if (!tag_allowed_set.empty() && tag_allowed_set.find(v.second) == tag_allowed_set.end()) continue;
-            if (stop_words_set.find(v.first) != stop_words_set.end()) continue;
-            word_tag_map[v.first] = v.second;
-            history_map.insert({t, v.first});
-            window_index.insert({t, v.first});
-            word_count_map[v.first]++;
-        }
-
-        // maintain sliding window
-        ll threshold = (currtime >= current_time_range_minutes * 60) ? (currtime - current_time_range_minutes * 60) : 0;
-        auto it_end = window_index.lower_bound(threshold);
-        for (auto it = window_index.begin(); it != it_end; ++it) {
-            auto wc = word_count_map.find(it->second);
-            if (wc != word_count_map.end()) {
-                wc->second--;
-                if (wc->second <= 0) word_count_map.erase(wc);
-            }
-        }
-        window_index.erase(window_index.begin(), it_end);
-    }
-
-    std::vector<std::pair<std::string,int>> query_topk(int minute, int topk) {
-        auto cmp = [&](const std::pair<std::string,int>& a, const std::pair<std::string,int>& b){
-            if (a.second == b.second) return a.first > b.first; // reverse lexicographic for ties
-            return a.second < b.second; // min-heap behavior
-        };
-        std::priority_queue<std::pair<std::string,int>, std::vector<std::pair<std::string,int>>, decltype(cmp)> pq(cmp);
-
-        ll qsec = minute * 60;
-        bool is_current_window = (currtime >= qsec) && (currtime - qsec < 60);
-        if (is_current_window) {
-            for (auto &p : word_count_map) pq.push(p);
-        } else {
-            ll start_time = (qsec >= current_time_range_minutes * 60) ? (qsec - current_time_range_minutes * 60) : 0;
-            std::unordered_map<std::string,int> temp;
-            auto it_start = history_map.lower_bound(start_time);
-            auto it_end = history_map.upper_bound(qsec + 59);
-            for (auto it = it_start; it != it_end; ++it) temp[it->second]++;
-            for (auto &p : temp) pq.push(p);
-        }
-
-        std::vector<std::pair<std::string,int>> res;
-        for (int i = 0; i < topk && !pq.empty(); ++i) { res.push_back(pq.top()); pq.pop(); }
-        return res;
-    }
-};
+#include "../scripts/engine.hpp"
 
 static bool expect(bool cond, const std::string& msg) {
     if (!cond) std::cerr << "[FAIL] " << msg << std::endl;
@@ -125,34 +30,49 @@ int main() {
     std::string userDict = std::string(JIEBA_DICT_DIR) + "/user.dict.utf8";
     std::string idfFile  = std::string(JIEBA_DICT_DIR) + "/idf.utf8";
     std::string stopFile = std::string(JIEBA_DICT_DIR) + "/stop_words.utf8";
-    cppjieba::Jieba jieba(mainDict, hmmModel, userDict, idfFile, stopFile);
+    cppjieba::Jieba jieba(mainDict, hmmModel, userDict, idfFile, stopFile, &kDictKeyNormalizer);
 
     // Load and insert user words like the app does
     std::vector<std::string> userterms;
     ReadUtf8Lines(std::string(INPUT_ROOT_DIR) + "/user_word.txt", userterms);
     for (auto &w : userterms) jieba.InsertUserWord(w, 20000);
 
-    HotWordsEngine eng;
-    eng.init_filters();
+    Config cfg{};
+    cfg.topk = 10;
+    cfg.time_range = 2; // default
+    cfg.normalize = true;
+    HotWordsEngine eng(jieba, cfg); // stop words and sensitive words from the project files
+
+    auto process_line = [&](int h, int m, int s, const std::string& sentence) {
+        char stamp[16];
+        std::snprintf(stamp, sizeof(stamp), "[%02d:%02d:%02d] ", h, m, s);
+        eng.IngestLine(stamp + sentence);
+    };
+    auto words_of = [&](const HotWordsEngine::TopList& top) {
+        std::vector<std::pair<std::string, int>> res;
+        for (auto &p : top) res.emplace_back(eng.counter().vocab().Word(p.first), p.second);
+        return res;
+    };
+    auto query_topk = [&](int minute, int topk) { return words_of(eng.Query(minute, topk)); };
 
     bool ok_all = true;
 
     // 1) Segmentation count & TopK accuracy
     // Process 3 occurrences of the user word "人工智能" around minute 1
-    eng.set_allowed_tags({}); // allow all POS
-    eng.set_window_size(5);
-    eng.process_line(jieba, 0, 1, 0, "人工智能很有用 人工智能改变世界");
-    eng.process_line(jieba, 0, 1, 20, "人工智能发展迅速");
-    eng.process_line(jieba, 0, 1, 50, "我们讨论人工智能以及应用");
-    auto top1 = eng.query_topk(1, 1);
+    eng.SetAllowedTags({}); // allow all POS
+    eng.SetWindowSize(5);
+    process_line(0, 1, 0, "人工智能很有用 人工智能改变世界");
+    process_line(0, 1, 20, "人工智能发展迅速");
+    process_line(0, 1, 50, "我们讨论人工智能以及应用");
+    auto top1 = query_topk(1, 1);
     bool case1 = expect(!top1.empty() && top1[0].first == "人工智能" && top1[0].second >= 3,
                         "Top1 should be 人工智能 with count >= 3 at minute 1");
     ok_all &= case1;
 
     // 2) Sensitive words filtering (words in input/sensitive_words.txt should be ignored)
     // Add a line with sensitive words; counts must not include them.
-    eng.process_line(jieba, 0, 1, 55, "黄 毒 赌 正常词");
-    auto res2 = eng.query_topk(1, 10);
+    process_line(0, 1, 55, "黄 毒 赌 正常词");
+    auto res2 = query_topk(1, 10);
     bool has_sensitive = false;
     for (auto &p : res2) {
         if (p.first == "黄" || p.first == "毒" || p.first == "赌") { has_sensitive = true; break; }
@@ -161,9 +81,9 @@ int main() {
     ok_all &= case2;
 
     // 3) POS filtering: allow only nouns (n, nz) and check that verbs are filtered
-    eng.set_allowed_tags({"n", "nz"});
-    eng.process_line(jieba, 0, 2, 10, "学生喜欢学习 人工智能"); // mix of nouns and verbs
-    auto res3 = eng.query_topk(2, 10);
+    eng.SetAllowedTags({"n", "nz"});
+    process_line(0, 2, 10, "学生喜欢学习 人工智能"); // mix of nouns and verbs
+    auto res3 = query_topk(2, 10);
     bool has_verb = false;
     for (auto &p : res3) {
         // common verb tokens: 喜欢/学习; they should be filtered when allowing only n/nz
@@ -174,10 +94,10 @@ int main() {
 
     // 4) Dynamic sliding window size: change window and verify query results
     // Create events at minute 1 and minute 5 for distinct tokens
-    eng.set_allowed_tags({});
-    eng.set_window_size(1); // narrow window
-    eng.process_line(jieba, 0, 5, 0, "大学 人工智能"); // minute 5
-    auto res4a = eng.query_topk(5, 10);
+    eng.SetAllowedTags({});
+    eng.SetWindowSize(1); // narrow window
+    process_line(0, 5, 0, "大学 人工智能"); // minute 5
+    auto res4a = query_topk(5, 10);
     bool contains_min5 = false, contains_min1 = false;
     for (auto &p : res4a) {
         if (p.first == "大学" || p.first == "人工智能") contains_min5 = true;
@@ -187,13 +107,47 @@ int main() {
     ok_all &= case4a;
 
     // Enlarge window to 10 minutes and expect earlier words to be counted
-    eng.set_window_size(10);
-    auto res4b = eng.query_topk(5, 10);
+    eng.SetWindowSize(10);
+    auto res4b = query_topk(5, 10);
     bool now_contains_min1 = false;
     for (auto &p : res4b) if (p.first == "学生") { now_contains_min1 = true; break; }
     bool case4b = expect(now_contains_min1, "After enlarging window to 10 minutes, earlier words should be included");
     ok_all &= case4b;
 
+    // 5) Batch ingest with an in-band query: the user word is counted, and the
+    // QUERY line answers with cfg.topk rows
+    std::vector<std::string_view> batch = {
+        "[00:03:10] 中山大学计算机学院 中山大学计算机学院",
+        "[ACTION] QUERY K=3",
+    };
+    std::vector<std::pair<std::string, int>> res5;
+    eng.IngestBatch(batch, [&](const ParsedLine& pl, size_t) {
+        if (pl.kind == ParsedLine::kQuery) res5 = words_of(eng.top());
+    });
+    bool has_user_word = false;
+    for (auto &p : res5) if (p.first == "中山大学计算机学院" && p.second == 2) { has_user_word = true; break; }
+    bool case5 = expect(has_user_word && res5.size() <= eng.topk(), "Batch QUERY@3 should list the user word 中山大学计算机学院 twice");
+    ok_all &= case5;
+
+    // 6) Normalization: input and dictionary keys are folded alike, so a
+    // mixed-case dictionary word matches upper-case, full-width and lower-case
+    // spellings, and a Kangxi radical reads as its unified ideograph
+    std::string folded = "ＡＢc⼤学T恤";
+    normalize_text(folded);
+    bool case6a = expect(folded == "abc大学t恤", "normalize_text folds full-width, ASCII upper case and Kangxi radicals");
+    jieba.InsertUserWord("T恤", 20000, "n");
+    process_line(0, 6, 0, "我买了T恤");
+    process_line(0, 6, 10, "他买了Ｔ恤");
+    process_line(0, 6, 20, "t恤很便宜 ⼤学");
+    int tshirt = 0, college = 0;
+    for (auto &p : query_topk(6, 20)) {
+        if (p.first == "t恤") tshirt = p.second;
+        if (p.first == "大学") college = p.second;
+    }
+    bool case6b = expect(case6a && tshirt == 3 && college >= 1,
+                         "Dictionary word T恤 matches T恤/Ｔ恤/t恤 as t恤, and ⼤学 counts as 大学");
+    ok_all &= case6b;
+
     if (!ok_all) {
         std::cerr << "\nSome tests FAILED." << std::endl;
         return 1;
@@ -1,4 +1,6 @@
 import os
+import re
+import socket
 import subprocess
 import threading
 from pathlib import Path
@@ -14,7 +16,7 @@ app = Flask(__name__)
 
 KEYS = [
     "input_file", "output_file", "dict_dir", "mode",
-    "topk", "time_range", "work_type", "normalize"
+    "topk", "time_range", "work_type", "normalize", "threads", "sensitive_filter", "server_listen"
 ]
 
 
@@ -263,6 +265,102 @@ def api_console_stop():
     return jsonify({"ok": True})
 
 
+# Server mode (work_type=3): one hotwords process keeps the dictionary loaded and
+# answers framed requests on server_listen; see scripts/server.hpp
+server_proc = None
+
+
+def _server_request(header: str, lines=None, timeout=60.0):
+    spec = read_config().get("server_listen", "tcp:127.0.0.1:7070")
+    if spec.startswith("unix:"):
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        addr = spec[5:]
+    else:
+        host, _, port = spec[4:].rpartition(":")
+        sock = socket.socket(socket.AF_INET6 if ":" in host else socket.AF_INET, socket.SOCK_STREAM)
+        addr = (host.strip("[]"), int(port))
+    with sock:
+        sock.settimeout(timeout)
+        sock.connect(addr)
+        payload = header + "\n" + "".join(str(l) + "\n" for l in (lines or []))
+        sock.sendall(payload.encode("utf-8"))
+        f = sock.makefile("rb")
+        status = f.readline().decode("utf-8").rstrip("\r\n")
+        body = []
+        if status.startswith("OK "):
+            for _ in range(int(status.split()[1])):
+                body.append(f.readline().decode("utf-8").rstrip("\r\n"))
+        return status, body
+
+
+def _server_reply(header: str, lines=None):
+    try:
+        status, body = _server_request(header, lines)
+    except OSError as e:
+        return jsonify({"ok": False, "error": f"server not reachable: {e}"}), 502
+    return jsonify({"ok": status.startswith("OK"), "status": status, "lines": body})
+
+
+@app.post("/api/server/start")
+def api_server_start():
+    global server_proc
+    if server_proc and server_proc.poll() is None:
+        return jsonify({"ok": True, "msg": "server already running"})
+    exe = find_hotwords_exe()
+    if not exe:
+        return jsonify({"ok": False, "error": "hotwords.exe not found"}), 400
+    if read_config().get("work_type") != "3":
+        write_config({"work_type": "3"})
+    try:
+        server_proc = subprocess.Popen([str(exe)], cwd=str(BUILD_DIR),
+                                       stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        return jsonify({"ok": True})
+    except Exception as e:
+        return jsonify({"ok": False, "error": str(e)}), 500
+
+@app.post("/api/server/ingest")
+def api_server_ingest():
+    data = request.json or {}
+    # split every item into physical lines before counting: an embedded
+    # newline would otherwise end up outside the INGEST <n> frame and run
+    # as a request of its own
+    if isinstance(data.get("lines"), list):
+        lines = [part for x in data["lines"] for part in re.split(r"\r\n|\r|\n", str(x))]
+    else:
+        lines = [s.rstrip("\r") for s in str(data.get("text", "")).splitlines()]
+    return _server_reply(f"INGEST {len(lines)}", lines)
+
+@app.get("/api/server/query")
+def api_server_query():
+    minute = request.args.get("minute", type=int, default=0)
+    k = request.args.get("k", type=int)
+    return _server_reply(f"QUERY {minute}" + (f" {k}" if k else ""))
+
+@app.post("/api/server/window")
+def api_server_window():
+    minutes = int((request.json or {}).get("minutes", 0))
+    return _server_reply(f"WINDOW_SIZE {minutes}")
+
+@app.get("/api/server/stats")
+def api_server_stats():
+    return _server_reply("STATS")
+
+@app.post("/api/server/stop")
+def api_server_stop():
+    global server_proc
+    try:
+        _server_request("SHUTDOWN", timeout=5.0)
+    except OSError:
+        pass
+    if server_proc:
+        try:
+            server_proc.wait(timeout=10)
+        except Exception:
+            server_proc.terminate()
+    server_proc = None
+    return jsonify({"ok": True})
+
+
 @app.get("/download/output")
 def download_output():
     cfg = read_config()
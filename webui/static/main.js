@@ -6,6 +6,7 @@ async function saveConfig() {
     time_range: document.getElementById('time_range').value,
     work_type: document.getElementById('work_type').value,
     normalize: document.getElementById('normalize').value,
+    sensitive_filter: document.getElementById('sensitive_filter').value,
   };
   const res = await fetch('/api/config', {
     method: 'POST',
@@ -50,6 +51,7 @@ if (runConfigBtn) {
       time_range: document.getElementById('time_range').value,
       work_type: '1',
       normalize: document.getElementById('normalize').value,
+      sensitive_filter: document.getElementById('sensitive_filter').value,
     };
     await fetch('/api/config', { method: 'POST', headers: { 'Content-Type': 'application/json' }, body: JSON.stringify(body) });
     await runHotwords();
@@ -67,6 +69,7 @@ if (timeRangeEl) {
       time_range: document.getElementById('time_range').value,
       work_type: '1',
       normalize: document.getElementById('normalize').value,
+      sensitive_filter: document.getElementById('sensitive_filter').value,
     };
     await fetch('/api/config', { method: 'POST', headers: { 'Content-Type': 'application/json' }, body: JSON.stringify(body) });
     await runHotwords();